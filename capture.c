@@ -0,0 +1,210 @@
+/**
+    * @file capture.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the motion capture buffer
+    * 
+    * This file contains the sample ring, the sampling function and the compressed dump.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "sys_timer.h"
+#include "capture.h"
+#include "encoder.h"
+
+/*!
+ * @brief One captured sample
+ */
+typedef struct capture_sample
+{
+    uint32_t time;           //!< Ticks since the capture started
+    int32_t position;        //!< Step position
+    int32_t velocity;        //!< Commanded velocity in steps/s, negative backward
+    int32_t encoder;         //!< External step/dir count
+    uint32_t flags;          //!< CAPTURE_FLAG bits
+} capture_sample_t;
+
+static capture_sample_t capture_samples[CAPTURE_SAMPLES];
+static int capture_head = 0;
+static int capture_count = 0;
+static bool capture_running = false;
+static uint32_t capture_ticks = 0;
+static uint32_t capture_period_ticks = 1;
+static uint32_t capture_next_tick = 0;
+
+/* -------------------------- capture functions -----------------------------*/
+bool capture_start(int rate_hz)
+{
+    if( rate_hz < 1 || rate_hz > CAPTURE_MAX_RATE_HZ )
+    {
+        return false;
+    }
+
+    capture_head = 0;
+    capture_count = 0;
+    capture_ticks = 0;
+    capture_next_tick = 0;
+    capture_period_ticks = (1000000 / TIMER_INTERVAL_US + rate_hz / 2) / rate_hz;
+    capture_running = true;
+    return true;
+}
+
+bool capture_stop(void)
+{
+    if( !capture_running )
+    {
+        return false;
+    }
+
+    capture_running = false;
+    return true;
+}
+
+bool capture_is_running(void)
+{
+    return capture_running;
+}
+
+bool process_capture(const stepper_state_t* stepper)
+{
+    capture_sample_t* sample;
+
+    if( !capture_running || stepper == NULL )
+    {
+        return false;
+    }
+
+    // Only moves are sampled, the time field shows the gaps between them
+    capture_ticks++;
+    if( !stepper->moving && !stepper->step_pin_high )
+    {
+        return false;
+    }
+    if( (int32_t)(capture_ticks - capture_next_tick) < 0 )
+    {
+        return false;
+    }
+    capture_next_tick = capture_ticks + capture_period_ticks;
+
+    // The ring keeps the latest samples, overwriting the oldest
+    sample = &capture_samples[capture_head];
+    sample->time = capture_ticks;
+    sample->position = stepper->current_position;
+    sample->velocity = (int32_t)((stepper->direction == STEPPER_DIRECTION_FORWARD) ? stepper->velocity : -stepper->velocity);
+    sample->encoder = encoder_get_count();
+    sample->flags = (stepper->moving ? CAPTURE_FLAG_MOVING : 0) |
+                    ((stepper->direction == STEPPER_DIRECTION_FORWARD) ? CAPTURE_FLAG_FORWARD : 0) |
+                    (stepper->step_pin_high ? CAPTURE_FLAG_STEP : 0) |
+                    (stepper->estop_stopping ? CAPTURE_FLAG_ESTOP : 0) |
+                    (stepper->gear_enabled ? CAPTURE_FLAG_GEAR : 0) |
+                    (stepper->track_enabled ? CAPTURE_FLAG_TRACK : 0);
+    capture_head = (capture_head + 1) % CAPTURE_SAMPLES;
+    if( capture_count < CAPTURE_SAMPLES )
+    {
+        capture_count++;
+    }
+    return true;
+}
+
+/*!
+ * @brief Append an unsigned LEB128 varint
+ *
+ * @param buffer: pointer to the output buffer, at least 5 bytes free
+ * @param value: value to append
+ * @return: number of bytes appended
+ */
+static int capture_put_varint(uint8_t* buffer, uint32_t value)
+{
+    int length = 0;
+
+    while( value >= 0x80 )
+    {
+        buffer[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t)value;
+    return length;
+}
+
+/*!
+ * @brief Append a signed difference as a zigzag coded varint
+ *
+ * @param buffer: pointer to the output buffer, at least 5 bytes free
+ * @param delta: difference to append
+ * @return: number of bytes appended
+ */
+static int capture_put_delta(uint8_t* buffer, int32_t delta)
+{
+    return capture_put_varint(buffer, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+}
+
+/*!
+ * @brief Print bytes as one line of hex
+ *
+ * @param buffer: pointer to the bytes
+ * @param length: number of bytes
+ * @return: none
+ */
+static void capture_print_line(const uint8_t* buffer, int length)
+{
+    for(int i = 0; i < length; i++)
+    {
+        printf("%02x", buffer[i]);
+    }
+    printf("\n");
+}
+
+bool capture_dump(void)
+{
+    uint8_t line[CAPTURE_DUMP_LINE_BYTES + 5 * 5];
+    int length = 0;
+    uint32_t bytes = 0;
+    capture_sample_t previous = { 0, 0, 0, 0, 0 };
+    int index;
+
+    capture_running = false;
+    if( capture_count == 0 )
+    {
+        return false;
+    }
+
+    printf("# claw capture: %d samples every %lu us, fields time position velocity encoder flags\n",
+           capture_count, (unsigned long)(capture_period_ticks * TIMER_INTERVAL_US));
+
+    index = (capture_head - capture_count + CAPTURE_SAMPLES) % CAPTURE_SAMPLES;
+    for(int i = 0; i < capture_count; i++)
+    {
+        const capture_sample_t* sample = &capture_samples[index];
+
+        length += capture_put_varint(&line[length], sample->time - previous.time);
+        length += capture_put_delta(&line[length], (int32_t)((uint32_t)sample->position - (uint32_t)previous.position));
+        length += capture_put_delta(&line[length], (int32_t)((uint32_t)sample->velocity - (uint32_t)previous.velocity));
+        length += capture_put_delta(&line[length], (int32_t)((uint32_t)sample->encoder - (uint32_t)previous.encoder));
+        length += capture_put_delta(&line[length], (int32_t)(sample->flags - previous.flags));
+        previous = *sample;
+        index = (index + 1) % CAPTURE_SAMPLES;
+
+        // Print whole lines, carrying any part sample over to the next line
+        if( length >= CAPTURE_DUMP_LINE_BYTES )
+        {
+            capture_print_line(line, CAPTURE_DUMP_LINE_BYTES);
+            bytes += CAPTURE_DUMP_LINE_BYTES;
+            length -= CAPTURE_DUMP_LINE_BYTES;
+            for(int j = 0; j < length; j++)
+            {
+                line[j] = line[CAPTURE_DUMP_LINE_BYTES + j];
+            }
+        }
+    }
+    if( length > 0 )
+    {
+        capture_print_line(line, length);
+        bytes += length;
+    }
+
+    printf("# end of capture, %lu bytes\n", (unsigned long)bytes);
+    return true;
+}
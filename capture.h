@@ -0,0 +1,86 @@
+/**
+    * @file capture.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the motion capture buffer
+    * 
+    * While capturing, the step engine state is sampled at up to 10 kHz whenever the stepper
+    * is moving into a RAM ring that keeps the latest samples. The dump streams the ring
+    * delta and varint compressed as hex lines:
+    *
+    *   # claw capture: <n> samples every <us> us, fields time position velocity encoder flags
+    *   <up to CAPTURE_DUMP_LINE_BYTES bytes as hex>
+    *   # end of capture, <bytes> bytes
+    *
+    * Each sample is five fields, each the difference from the same field of the previous
+    * sample (from zero for the first), as LEB128 varints, 7 bits per byte low bits first
+    * with the top bit set on all but the last byte. The time in 10 us ticks since the
+    * capture started only increases so is unsigned, the other fields are zigzag coded,
+    * (n << 1) ^ (n >> 31), so small changes either way stay short. The velocity is the
+    * commanded velocity in steps/s, negative travelling backward, and the flags are the
+    * CAPTURE_FLAG bits.
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stepper.h"
+
+#define CAPTURE_SAMPLES                     4096    // Samples kept in the ring, 0.4 s at the highest rate
+#define CAPTURE_MAX_RATE_HZ                 10000   // Highest sample rate
+#define CAPTURE_DUMP_LINE_BYTES             32      // Compressed bytes per dump line
+
+#define CAPTURE_FLAG_MOVING                 0x01    // Move in progress
+#define CAPTURE_FLAG_FORWARD                0x02    // Travelling forward
+#define CAPTURE_FLAG_STEP                   0x04    // Step pulse issued on the sampled tick
+#define CAPTURE_FLAG_ESTOP                  0x08    // Braking for an estop
+#define CAPTURE_FLAG_GEAR                   0x10    // Following the external axis
+#define CAPTURE_FLAG_TRACK                  0x20    // Following tracking setpoints
+
+/*!
+ * @brief Start capturing, discarding any previous capture
+ *
+ * @param rate_hz: sample rate from 1 to CAPTURE_MAX_RATE_HZ, rounded to a whole number of ticks
+ * @return: true on success, false on an invalid rate
+ */
+bool capture_start(int rate_hz);
+
+/*!
+ * @brief Stop capturing, the samples are kept for capture_dump()
+ *
+ * @param: none
+ * @return: true on success, false if not capturing
+ */
+bool capture_stop(void);
+
+/*!
+ * @brief Check whether a capture is in progress
+ *
+ * @param: none
+ * @return: true if capturing, false otherwise
+ */
+bool capture_is_running(void);
+
+/*!
+ * @brief Print the captured samples compressed, stopping any capture in progress
+ *
+ * @param: none
+ * @return: true on success, false if there are no samples
+ */
+bool capture_dump(void);
+
+/*!
+ * @brief Take a sample if one is due
+ *
+ * @note: Called every TIMER_INTERVAL_US while capturing, after the movement.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if a sample was taken, false otherwise
+ */
+bool process_capture(const stepper_state_t* stepper);
+
+#endif // CAPTURE_H
@@ -24,6 +24,11 @@
 #include "stepper.h"
 #include "led.h"
 #include "command_processor.h"
+#include "wcet.h"
+#include "encoder.h"
+#include "task.h"
+#include "claw_tasks.h"
+#include "modbus.h"
 
 /*!
  * @brief Main function
@@ -32,14 +37,20 @@
  */ 
 int main()
 {
-    char* cmd;
     stepper_state_t stepper;
 
     // Initialise the LED and stdio
     int rc = pico_led_init();
     hard_assert(rc == PICO_OK);
     stdio_init_all();
+    wcet_init();
     stepper_init(&stepper, 0, DEFAULT_STEPPER_PERIOD);
+    encoder_init();
+    modbus_init();
+    if(!claw_tasks_init(&stepper))
+    {
+        panic("Could not register the firmware tasks");
+    }
     
     // Set up repeating timer
     struct repeating_timer timer;
@@ -60,7 +71,7 @@ int main()
     // Prompt for command
     printf("#: ");
 
-    // Main loop
+    // Main loop, the tasks and their order are registered by claw_tasks_init()
     while (true) 
     {
         // Process millisecond tasks
@@ -68,27 +79,7 @@ int main()
         {
             // Decrement the tick count
             ms_ticks_count--;
-
-            // Process LED timing
-            process_led_tick(); 
-
-            // Process stdin input
-            cmd = process_stdin_input();
-            
-            // If we have a command, process it
-            if(cmd != NULL)
-            {
-                process_command(cmd, &stepper);
-                // Reset for next command
-                printf("#: ");
-                cmd = NULL; // Clear command pointer, probably not necessary
-            }
-            
-            // Process stepper estop input and stepper status LEDs
-            process_stepper_estop(&stepper);
-
-            // Process stepper enabled LED
-            process_stepper_enabled_led(&stepper);
+            task_run(TASK_RATE_MS);
         }
 
         // Process ten microsecond tasks
@@ -96,12 +87,7 @@ int main()
         {
             // Decrement the tick count
             ten_us_ticks_count--;
-
-            // Process stepper movement
-            if(stepper.moving)
-            {
-                process_stepper_movement(&stepper); 
-            }
+            task_run(TASK_RATE_TEN_US);
         }
     }
 }
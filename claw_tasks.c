@@ -0,0 +1,213 @@
+/**
+    * @file claw_tasks.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the claw superloop task list
+    * 
+    * This file contains the task functions and their registration, in superloop order.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "sys_timer.h"
+#include "task.h"
+#include "claw_tasks.h"
+#include "led.h"
+#include "command_processor.h"
+#include "wcet.h"
+#include "encoder.h"
+#include "probe.h"
+#include "start_input.h"
+#include "capture.h"
+#include "move_stats.h"
+#include "modbus.h"
+
+/* -------------------------- millisecond tasks -----------------------------*/
+static bool claw_task_led(void* context)
+{
+    (void)context;
+
+    // Process LED timing
+    process_led_tick();
+    return true;
+}
+
+/*!
+ * @brief Command input protothread, one command per tick
+ *
+ * @note: While a command reply is deferred input is held off and the command is resumed
+ *        every tick from the next one on, the prompt follows its reply.
+ *
+ * @param pt: pointer to the resume point
+ * @param stepper: pointer to stepper state structure
+ * @return: TASK_WAITING, the thread never ends
+ */
+static task_status_t claw_command_thread(task_pt_t* pt, stepper_state_t* stepper)
+{
+    static char* cmd;
+
+    TASK_BEGIN(pt);
+    while(true)
+    {
+        // Process stdin input until we have a command
+        TASK_WAIT_UNTIL(pt, (cmd = process_stdin_input()) != NULL);
+        process_command(cmd, stepper);
+
+        if(command_is_pending())
+        {
+            // Complete the deferred command reply
+            TASK_YIELD(pt);
+            TASK_WAIT_UNTIL(pt, WCET_MEASURE(WCET_COMMAND_PENDING, process_pending_command(stepper)));
+            printf("#: ");
+        }
+        // Reset for next command unless there was no reply
+        else if(!command_is_quiet())
+        {
+            printf("#: ");
+        }
+        TASK_YIELD(pt);
+    }
+    TASK_END(pt);
+}
+
+static bool claw_task_command(void* context)
+{
+    static task_pt_t command_pt = { 0 };
+
+    claw_command_thread(&command_pt, (stepper_state_t*)context);
+    return true;
+}
+
+static bool claw_task_estop(void* context)
+{
+    // Process stepper estop input and stepper status LEDs
+    WCET_MEASURE(WCET_STEPPER_ESTOP, process_stepper_estop((stepper_state_t*)context));
+    return true;
+}
+
+static bool claw_task_enabled_led(void* context)
+{
+    // Process stepper enabled LED
+    process_stepper_enabled_led((stepper_state_t*)context);
+    return true;
+}
+
+static bool claw_task_modbus(void* context)
+{
+    // Answer a Modbus request received since the last tick
+    return WCET_MEASURE(WCET_MODBUS, process_modbus((stepper_state_t*)context));
+}
+
+/* -------------------------- ten microsecond tasks -----------------------------*/
+static bool claw_task_gearing(void* context)
+{
+    stepper_state_t* stepper = (stepper_state_t*)context;
+
+    // Follow the external axis when geared to it
+    if(!stepper->gear_enabled)
+    {
+        return false;
+    }
+    WCET_MEASURE(WCET_STEPPER_GEARING, process_stepper_gearing(stepper, encoder_get_count()));
+    return true;
+}
+
+static bool claw_task_tracking(void* context)
+{
+    stepper_state_t* stepper = (stepper_state_t*)context;
+
+    // Run the setpoint tracking filter
+    if(!stepper->track_enabled)
+    {
+        return false;
+    }
+    WCET_MEASURE(WCET_STEPPER_TRACKING, process_stepper_tracking(stepper));
+    return true;
+}
+
+static bool claw_task_start_input(void* context)
+{
+    // Start the armed move once the start input has seen its edge
+    return process_start_input((stepper_state_t*)context);
+}
+
+static bool claw_task_probe(void* context)
+{
+    // Brake to a stop once the probe has triggered, when armed to
+    return process_probe((stepper_state_t*)context);
+}
+
+static bool claw_task_movement(void* context)
+{
+    stepper_state_t* stepper = (stepper_state_t*)context;
+
+    // Process stepper movement, including ending the last step and trigger pulses
+    if(!stepper->moving && !stepper->step_pin_high && stepper->trigger_pulses <= 0)
+    {
+        return false;
+    }
+    WCET_MEASURE(WCET_STEPPER_MOVEMENT, process_stepper_movement(stepper));
+    return true;
+}
+
+static bool claw_task_move_stats(void* context)
+{
+    stepper_state_t* stepper = (stepper_state_t*)context;
+
+    // Keep the statistics of the move, ticks still waiting show how late this one ran
+    if(!stepper->moving && !move_stats_is_recording())
+    {
+        return false;
+    }
+    WCET_MEASURE(WCET_MOVE_STATS, process_move_stats(stepper, ten_us_ticks_count));
+    return true;
+}
+
+static bool claw_task_capture(void* context)
+{
+    // Sample the move into the capture ring
+    if(!capture_is_running())
+    {
+        return false;
+    }
+    WCET_MEASURE(WCET_CAPTURE, process_capture((stepper_state_t*)context));
+    return true;
+}
+
+static bool claw_task_modbus_uart(void* context)
+{
+    (void)context;
+
+    // Move Modbus bytes between the UART FIFOs and the frame buffers
+    return process_modbus_uart();
+}
+
+/* -------------------------- registration -----------------------------*/
+bool claw_tasks_init(stepper_state_t* stepper)
+{
+    bool ok = true;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    ok &= task_register("led", TASK_RATE_MS, claw_task_led, stepper);
+    ok &= task_register("command", TASK_RATE_MS, claw_task_command, stepper);
+    ok &= task_register("estop", TASK_RATE_MS, claw_task_estop, stepper);
+    ok &= task_register("enabled_led", TASK_RATE_MS, claw_task_enabled_led, stepper);
+    ok &= task_register("modbus", TASK_RATE_MS, claw_task_modbus, stepper);
+
+    ok &= task_register("gearing", TASK_RATE_TEN_US, claw_task_gearing, stepper);
+    ok &= task_register("tracking", TASK_RATE_TEN_US, claw_task_tracking, stepper);
+    ok &= task_register("start_input", TASK_RATE_TEN_US, claw_task_start_input, stepper);
+    ok &= task_register("probe", TASK_RATE_TEN_US, claw_task_probe, stepper);
+    ok &= task_register("movement", TASK_RATE_TEN_US, claw_task_movement, stepper);
+    ok &= task_register("move_stats", TASK_RATE_TEN_US, claw_task_move_stats, stepper);
+    ok &= task_register("capture", TASK_RATE_TEN_US, claw_task_capture, stepper);
+    ok &= task_register("modbus_uart", TASK_RATE_TEN_US, claw_task_modbus_uart, stepper);
+
+    return ok;
+}
@@ -0,0 +1,31 @@
+/**
+    * @file claw_tasks.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the claw superloop task list
+    * 
+    * The firmware and the host simulator register the same tasks, in the same order, so
+    * both run the same superloop.
+*/
+
+#ifndef CLAW_TASKS_H
+#define CLAW_TASKS_H
+
+#include <stdbool.h>
+#include "stepper.h"
+
+/*!
+ * @brief Register the millisecond and ten microsecond tasks of the claw
+ *
+ * @note: Millisecond tasks: LED, command input and replies, estop, enabled LED, Modbus.
+ *        Ten microsecond tasks: gearing, tracking, start input, probe, movement,
+ *        move statistics, capture, Modbus UART.
+ *
+ * @param stepper: pointer to stepper state structure, passed to every task
+ * @return: true on success, false if a task could not be registered
+ */
+bool claw_tasks_init(stepper_state_t* stepper);
+
+#endif // CLAW_TASKS_H
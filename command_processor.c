@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include <string.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <math.h>
@@ -20,9 +21,23 @@
 #include "stepper.h"
 #include "led.h"
 #include "command_processor.h"
+#include "wcet.h"
+#include "profiler.h"
+#include "session.h"
+#include "encoder.h"
+#include "probe.h"
+#include "start_input.h"
+#include "capture.h"
+#include "event_log.h"
+#include "task.h"
+#include "move_stats.h"
+#include "modbus.h"
 
 // Command definitions
-#define MAX_COMMAND_LENGTH              50
+#define MAX_COMMAND_LENGTH              160
+#define MAX_BATCH_COMMANDS              8
+#define BATCH_SEPARATOR                 ';'
+#define MAX_BATCH_REPLY                 160
 
 #define CLAW_SET_POSITION_COMMAND       "claw_set "
 #define LED_PERIOD_COMMAND              "led_period "
@@ -37,6 +52,29 @@
 #define ENABLE_STEPPER_COMMAND          "enable_stepper"
 #define DISABLE_STEPPER_COMMAND         "disable_stepper"
 #define ECHO_COMMAND                    "echo "
+#define WAIT_IDLE_COMMAND               "wait_idle"
+#define WCET_REPORT_COMMAND             "wcet_report"
+#define WCET_RESET_COMMAND              "wcet_reset"
+#define PROFILE_COMMAND                 "profile "
+#define RECORD_COMMAND                  "record "
+#define CAPTURE_COMMAND                 "capture "
+#define LOG_COMMAND                     "log "
+#define SET_STEPPER_ACCEL_COMMAND       "set_stepper_accel "
+#define FEED_OVERRIDE_COMMAND           "feed_override "
+#define SET_STEPPER_DECEL_COMMAND       "set_stepper_decel "
+#define ESTOP_MODE_COMMAND              "estop_mode "
+#define SET_BACKLASH_COMMAND            "set_backlash "
+#define APPROACH_MODE_COMMAND           "approach_mode "
+#define SPEED_ZONE_COMMAND              "speed_zone "
+#define ACCEL_POINT_COMMAND             "accel_point "
+#define GEAR_COMMAND                    "gear "
+#define TRIGGER_COMMAND                 "trigger "
+#define PROBE_COMMAND                   "probe "
+#define ARM_MOVE_COMMAND                "arm_move "
+#define TRACK_COMMAND                   "track "
+#define MOVE_STATS_COMMAND              "move_stats"
+#define MODBUS_COMMAND                  "modbus"
+#define TRACK_SETPOINT_PREFIX           '@'
 
 /*! 
  * @brief Help message
@@ -49,21 +87,108 @@ const char* help_message =
     "  claw_set <position>                - Set the claw position 0 to 100\n"
     "  led_period <ms>                    - Set the LED blink period in milliseconds\n"
     "  set_stepper_period <us>            - Set the stepper motor step period in us\n"
+    "  set_stepper_accel <steps/s^2>      - Set the stepper acceleration\n"
+    "  set_stepper_decel <steps/s^2>      - Set the stepper deceleration\n"
+    "  feed_override <percent>            - Scale the stepper speed, including the move in progress\n"
+    "  estop_mode <instant|decel> [steps/s^2] - Estop de-energises at once, or brakes first\n"
+    "  set_backlash <steps>               - Set the backlash taken up on each reversal\n"
+    "  approach_mode <off|forward|backward> [steps] - Finish every move in one direction\n"
+    "  speed_zone <n> <start> <end> <steps/s> - Limit the speed between two positions\n"
+    "  speed_zone <n> off                 - Clear speed limit zone n\n"
+    "  accel_point <n> <steps/s> <steps/s^2> - Set point n of the acceleration against speed table\n"
+    "  accel_point <n> off                - Clear the acceleration table from point n up\n"
+    "  gear <steps> <external steps>      - Follow the external step/dir input at this ratio\n"
+    "  gear off                           - Stop following the external input\n"
+    "  trigger <n> <position> <pin> <us> [forward|backward] - Pulse a pin on reaching a position\n"
+    "  trigger <n> off                    - Clear output trigger n\n"
+    "  probe arm <rising|falling> [stop]  - Latch the position on the next probe edge, optionally stopping\n"
+    "  probe <disarm|read>                - Disarm the probe or show the latched position\n"
+    "  arm_move <absolute|relative> <steps> <rising|falling> [repeat] - Start a move on a start input edge\n"
+    "  arm_move off                       - Disarm the start input\n"
+    "  track <on|off>                     - Follow a stream of setpoints smoothly, claw_set feeds it too\n"
+    "  @<steps>                           - Tracking setpoint, no reply unless it is rejected\n"
     "  set_stepper_zero                   - Set the current position to zero\n"
     "  move_stepper_absolute <steps>      - Move the stepper to an absolute position\n"
     "  move_stepper_relative <steps>      - Move the stepper by a relative number of steps\n"
     "  move_stepper_rotations <rotations> - Move the stepper by a number of rotations\n"
     "  move_stepper_bump_down             - Move the stepper down by a small fixed amount\n"
-    "  stop_stepper                       - Stop the stepper motor\n"
+    "  stop_stepper [decel]               - Stop the stepper motor, instantly or at the deceleration\n"
     "  get_stepper_status                 - Get the current status of the stepper motor\n"
     "  enable_stepper                     - Enable the stepper motor\n"
     "  disable_stepper                    - Disable the stepper motor\n"
     "  echo <on|off>                      - Enable or disable command echoing\n"
+    "  wait_idle [timeout_ms]             - Reply once the stepper has stopped moving\n"
+    "  move_stats [count|clear]           - Show statistics of the latest moves, or clear them\n"
+    "  modbus [address <1-247>]           - Show the Modbus RTU server counters, or set its address\n"
+    "  wcet_report                        - Show worst case execution times\n"
+    "  wcet_reset                         - Clear worst case execution times\n"
+    "  profile <start|stop|dump>          - Control the sampling profiler\n"
+    "  record <start|stop|dump>           - Record timestamped command sessions\n"
+    "  capture start <hz>                 - Sample every move into the capture ring, up to 10 kHz\n"
+    "  capture <stop|dump>                - Stop capturing or print the compressed samples\n"
+    "  log <text|dump|clear>              - Print the event log, as text or hex for claw_logfmt\n"
+    "  <command>; <command>; ...          - Check stepper commands together, then apply them all in one tick\n"
     "  help                               - Show this help message\n"
     "-----\n";
 
 bool echo_command = true;
 
+/*!
+ * @brief State of a command whose reply has been deferred
+ *
+ * A deferred command returns from process_command() straight away and its handler,
+ * a protothread (see task.h), is then resumed by process_pending_command() on every
+ * later millisecond tick until it has replied.
+ */
+typedef task_status_t (*pending_handler_t)(stepper_state_t* stepper);
+
+typedef struct pending_command
+{
+    pending_handler_t handler;      //!< Resumable handler, NULL if no reply is outstanding
+    task_pt_t pt;                   //!< Resume point of the handler
+    int timeout_ms;                 //!< Timeout in milliseconds, 0 for no timeout
+    int elapsed_ms;                 //!< Milliseconds elapsed since the command was received
+    stepper_snapshot_t snapshot;    //!< State the handler last waited on
+} pending_command_t;
+
+static pending_command_t pending_command = { NULL };
+
+// Set when the last command completed without a reply, so no prompt follows it
+static bool quiet_command = false;
+
+// Set while a batch is checked against the scratch state, replies then go to batch_reply
+static bool batch_checking = false;
+static char batch_reply[MAX_BATCH_REPLY];
+
+static bool command_dispatch(const char* cmd, stepper_state_t* stepper);
+
+/*!
+ * @brief Reply to a command that may be batched
+ *
+ * @note: While a batch is checked the reply is kept in batch_reply instead of printed,
+ *        so the error of a failing command can be shown without running it again.
+ *
+ * @param format: printf() format string, followed by its arguments
+ * @return: none
+ */
+static void command_reply(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if(batch_checking)
+    {
+        size_t used = strlen(batch_reply);
+
+        vsnprintf(batch_reply + used, sizeof(batch_reply) - used, format, args);
+    }
+    else
+    {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
 /* -------------------------- command processor -----------------------------*/
 bool process_command(const char* cmd, stepper_state_t* stepper)
 {
@@ -80,67 +205,164 @@ bool process_command(const char* cmd, stepper_state_t* stepper)
         return false;
     }
 
+    quiet_command = false;
+
+    // Record the command for host replay, except the record command itself
+    if(strncmp(cmd, RECORD_COMMAND, strlen(RECORD_COMMAND)) != 0)
+    {
+        session_record(cmd);
+    }
+
+    // Several commands on one line are checked together, then applied together
+    if (strchr(cmd, BATCH_SEPARATOR) != NULL)
+    {
+        return WCET_MEASURE(WCET_COMMAND_BATCH, command_batch(stepper, cmd));
+    }
+
+    return command_dispatch(cmd, stepper);
+}
+
+/*!
+ * @brief Run a single command
+ *
+ * @param cmd: pointer to command string, without any batch separator
+ * @param stepper: pointer to stepper state structure
+ * @return: true on success, false on failure
+ */
+static bool command_dispatch(const char* cmd, stepper_state_t* stepper)
+{
+    // Tracking setpoints can arrive at 100 Hz so are checked first and not answered
+    if (cmd[0] == TRACK_SETPOINT_PREFIX)
+    {
+        return WCET_MEASURE(WCET_COMMAND_TRACK_SETPOINT, command_track_setpoint(stepper, cmd));
+    }
+
     // claw set position command
     if (strncmp(cmd, CLAW_SET_POSITION_COMMAND, strlen(CLAW_SET_POSITION_COMMAND)) == 0) 
     {
-        return command_claw_set_position(stepper, cmd);
+        return WCET_MEASURE(WCET_COMMAND_CLAW_SET, command_claw_set_position(stepper, cmd));
     }  
     // command to set LED period
     else if (strncmp(cmd, LED_PERIOD_COMMAND, strlen(LED_PERIOD_COMMAND)) == 0) 
     {
-        return command_set_led_period(cmd);
+        return WCET_MEASURE(WCET_COMMAND_LED_PERIOD, command_set_led_period(cmd));
     }
     // command to set stepper period
     else if(strncmp(cmd, SET_STEPPER_PERIOD_COMMAND, strlen(SET_STEPPER_PERIOD_COMMAND)) == 0)
     {
-        return command_set_stepper_period(stepper, cmd);
+        return WCET_MEASURE(WCET_COMMAND_SET_STEPPER_PERIOD, command_set_stepper_period(stepper, cmd));
+    }
+    // command to set stepper acceleration
+    else if(strncmp(cmd, SET_STEPPER_ACCEL_COMMAND, strlen(SET_STEPPER_ACCEL_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_SET_STEPPER_ACCEL, command_set_stepper_accel(stepper, cmd));
+    }
+    // command to set stepper deceleration
+    else if(strncmp(cmd, SET_STEPPER_DECEL_COMMAND, strlen(SET_STEPPER_DECEL_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_SET_STEPPER_DECEL, command_set_stepper_decel(stepper, cmd));
+    }
+    // command to set estop mode
+    else if(strncmp(cmd, ESTOP_MODE_COMMAND, strlen(ESTOP_MODE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_ESTOP_MODE, command_estop_mode(stepper, cmd));
+    }
+    // command to set backlash compensation
+    else if(strncmp(cmd, SET_BACKLASH_COMMAND, strlen(SET_BACKLASH_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_SET_BACKLASH, command_set_backlash(stepper, cmd));
+    }
+    // command to set unidirectional approach mode
+    else if(strncmp(cmd, APPROACH_MODE_COMMAND, strlen(APPROACH_MODE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_APPROACH_MODE, command_approach_mode(stepper, cmd));
+    }
+    // command to set a speed limit zone
+    else if(strncmp(cmd, SPEED_ZONE_COMMAND, strlen(SPEED_ZONE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_SPEED_ZONE, command_speed_zone(stepper, cmd));
+    }
+    // command to set a point on the acceleration table
+    else if(strncmp(cmd, ACCEL_POINT_COMMAND, strlen(ACCEL_POINT_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_ACCEL_POINT, command_accel_point(stepper, cmd));
+    }
+    // command to engage electronic gearing
+    else if(strncmp(cmd, GEAR_COMMAND, strlen(GEAR_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_GEAR, command_gear(stepper, cmd));
+    }
+    // command to set a position synchronised output trigger
+    else if(strncmp(cmd, TRIGGER_COMMAND, strlen(TRIGGER_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_TRIGGER, command_trigger(stepper, cmd));
+    }
+    // command to arm or read the touch probe
+    else if(strncmp(cmd, PROBE_COMMAND, strlen(PROBE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_PROBE, command_probe(stepper, cmd));
+    }
+    // command to arm a move started by the start input
+    else if(strncmp(cmd, ARM_MOVE_COMMAND, strlen(ARM_MOVE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_ARM_MOVE, command_arm_move(stepper, cmd));
+    }
+    // command to engage setpoint tracking
+    else if(strncmp(cmd, TRACK_COMMAND, strlen(TRACK_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_TRACK, command_track(stepper, cmd));
+    }
+    // command to set feed rate override
+    else if(strncmp(cmd, FEED_OVERRIDE_COMMAND, strlen(FEED_OVERRIDE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_FEED_OVERRIDE, command_feed_override(stepper, cmd));
     }
     // command to set stepper position to zero
     else if(strncmp(cmd, SET_STEPPER_ZERO_COMMAND, strlen(SET_STEPPER_ZERO_COMMAND)) == 0)
     {
-        return command_set_stepper_zero(stepper);
+        return WCET_MEASURE(WCET_COMMAND_SET_STEPPER_ZERO, command_set_stepper_zero(stepper));
     }
     // command to move stepper to absolute position
     else if(strncmp(cmd, MOVE_STEPPER_ABSOLUTE_COMMAND, strlen(MOVE_STEPPER_ABSOLUTE_COMMAND)) == 0)
     {
-        return command_move_stepper_absolute(stepper, cmd);
+        return WCET_MEASURE(WCET_COMMAND_MOVE_ABSOLUTE, command_move_stepper_absolute(stepper, cmd));
     }
     // command to move stepper by relative steps
     else if(strncmp(cmd, MOVE_STEPPER_RELATIVE_COMMAND, strlen(MOVE_STEPPER_RELATIVE_COMMAND)) == 0)
     {
-        return command_move_stepper_relative(stepper, cmd);
+        return WCET_MEASURE(WCET_COMMAND_MOVE_RELATIVE, command_move_stepper_relative(stepper, cmd));
     }
     // command to move stepper by relative rotations
     else if(strncmp(cmd, MOVE_STEPPER_ROTATIONS_COMMAND, strlen(MOVE_STEPPER_ROTATIONS_COMMAND)) == 0)
     {
-        return command_move_stepper_rotations(stepper, cmd);
+        return WCET_MEASURE(WCET_COMMAND_MOVE_ROTATIONS, command_move_stepper_rotations(stepper, cmd));
     }
     // command to bump stepper down by fixed amount
     else if(strncmp(cmd, MOVE_STEPPER_BUMP_DOWN_COMMAND, strlen(MOVE_STEPPER_BUMP_DOWN_COMMAND)) == 0)
     {
-        return command_move_stepper_bump_down(stepper);
+        return WCET_MEASURE(WCET_COMMAND_MOVE_BUMP_DOWN, command_move_stepper_bump_down(stepper));
     }
     // command to stop stepper
     else if(strncmp(cmd, STOP_STEPPER_COMMAND, strlen(STOP_STEPPER_COMMAND)) == 0)
     {
-       return command_stop_stepper(stepper);
+       return WCET_MEASURE(WCET_COMMAND_STOP, command_stop_stepper(stepper, cmd));
     }
     // command to get stepper status
     else if(strncmp(cmd, GET_STEPPER_STATUS_COMMAND, strlen(GET_STEPPER_STATUS_COMMAND)) == 0)
     {
-        return command_get_stepper_status(stepper);
+        return WCET_MEASURE(WCET_COMMAND_GET_STATUS, command_get_stepper_status(stepper));
     }
     // command to enable stepper
     else if(strncmp(cmd, ENABLE_STEPPER_COMMAND, strlen(ENABLE_STEPPER_COMMAND)) == 0)
     {
-        stepper_enable(stepper, true);
+        WCET_MEASURE(WCET_COMMAND_ENABLE, stepper_enable(stepper, true));
         printf("Stepper motor enabled\n");
         return true;
     }
     // command to disable stepper
     else if(strncmp(cmd, DISABLE_STEPPER_COMMAND, strlen(DISABLE_STEPPER_COMMAND)) == 0)
     {
-        stepper_enable(stepper, false); 
+        WCET_MEASURE(WCET_COMMAND_DISABLE, stepper_enable(stepper, false));
         printf("Stepper motor disabled\n");
         return true;
     }
@@ -153,7 +375,54 @@ bool process_command(const char* cmd, stepper_state_t* stepper)
     // command to set echo on or off
     else if (strncmp(cmd, ECHO_COMMAND, strlen(ECHO_COMMAND)) == 0)
     {
-        return command_set_echo(cmd);
+        return WCET_MEASURE(WCET_COMMAND_ECHO, command_set_echo(cmd));
+    }
+    // command to wait for the stepper to become idle
+    else if (strncmp(cmd, WAIT_IDLE_COMMAND, strlen(WAIT_IDLE_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_WAIT_IDLE, command_wait_idle(stepper, cmd));
+    }
+    // command to show per move statistics
+    else if (strncmp(cmd, MOVE_STATS_COMMAND, strlen(MOVE_STATS_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_MOVE_STATS, command_move_stats(cmd));
+    }
+    // command to show or configure the Modbus server
+    else if (strncmp(cmd, MODBUS_COMMAND, strlen(MODBUS_COMMAND)) == 0)
+    {
+        return WCET_MEASURE(WCET_COMMAND_MODBUS, command_modbus(cmd));
+    }
+    // command to report worst case execution times
+    else if (strncmp(cmd, WCET_REPORT_COMMAND, strlen(WCET_REPORT_COMMAND)) == 0)
+    {
+        return command_wcet_report();
+    }
+    // command to clear worst case execution times
+    else if (strncmp(cmd, WCET_RESET_COMMAND, strlen(WCET_RESET_COMMAND)) == 0)
+    {
+        wcet_reset();
+        printf("WCET measurements cleared\n");
+        return true;
+    }
+    // command to control the sampling profiler
+    else if (strncmp(cmd, PROFILE_COMMAND, strlen(PROFILE_COMMAND)) == 0)
+    {
+        return command_profile(stepper, cmd);
+    }
+    // command to record command sessions
+    else if (strncmp(cmd, RECORD_COMMAND, strlen(RECORD_COMMAND)) == 0)
+    {
+        return command_record(stepper, cmd);
+    }
+    // command to capture move profiles
+    else if (strncmp(cmd, CAPTURE_COMMAND, strlen(CAPTURE_COMMAND)) == 0)
+    {
+        return command_capture(stepper, cmd);
+    }
+    // command to read the event log
+    else if (strncmp(cmd, LOG_COMMAND, strlen(LOG_COMMAND)) == 0)
+    {
+        return command_log(stepper, cmd);
     }
     // unknown command
     else 
@@ -167,6 +436,118 @@ bool process_command(const char* cmd, stepper_state_t* stepper)
     return true;
 }
 
+bool command_is_pending(void)
+{
+    return pending_command.handler != NULL;
+}
+
+bool command_is_quiet(void)
+{
+    return quiet_command;
+}
+
+bool process_pending_command(stepper_state_t* stepper)
+{
+    if( pending_command.handler == NULL || stepper == NULL )
+    {
+        return false;
+    }
+
+    pending_command.elapsed_ms++;
+
+    if(pending_command.handler(stepper) == TASK_WAITING)
+    {
+        return false;
+    }
+    pending_command.handler = NULL;
+    return true;
+}
+
+/*!
+ * @brief Defer the reply of the current command to a resumable handler
+ *
+ * @param handler: protothread resumed every millisecond tick until it has replied
+ * @param timeout_ms: timeout in milliseconds, 0 for no timeout
+ * @return: none
+ */
+static void command_defer(pending_handler_t handler, int timeout_ms)
+{
+    pending_command.handler = handler;
+    TASK_INIT(&pending_command.pt);
+    pending_command.timeout_ms = timeout_ms;
+    pending_command.elapsed_ms = 0;
+}
+
+/*!
+ * @brief Wait condition of a deferred command, the stepper stopped or the timeout reached
+ *
+ * @note: Estop aborts the wait once it has stopped the stepper, after any category 1 braking.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true once the wait is over, with the state in pending_command.snapshot
+ */
+static bool command_wait_stopped(stepper_state_t* stepper)
+{
+    // Try again next tick if the state was being updated
+    if(!stepper_get_snapshot(stepper, &pending_command.snapshot))
+    {
+        return false;
+    }
+    return !pending_command.snapshot.moving ||
+           (pending_command.timeout_ms > 0 && pending_command.elapsed_ms >= pending_command.timeout_ms);
+}
+
+/*!
+ * @brief Resumable handler of wait_idle, replies once the stepper is idle
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: TASK_DONE once replied, TASK_WAITING otherwise
+ */
+static task_status_t command_wait_idle_resume(stepper_state_t* stepper)
+{
+    TASK_BEGIN(&pending_command.pt);
+    TASK_WAIT_UNTIL(&pending_command.pt, command_wait_stopped(stepper));
+
+    if(pending_command.snapshot.moving)
+    {
+        printf("Error: wait_idle timed out after %d ms at position %d\n", pending_command.elapsed_ms,
+               pending_command.snapshot.current_position);
+        EVENT_LOG("wait_idle timed out after %d ms at %d", pending_command.elapsed_ms,
+                  pending_command.snapshot.current_position);
+    }
+    else if(stepper_is_estop_active(stepper))
+    {
+        printf("Error: wait_idle aborted by estop at position %d\n", pending_command.snapshot.current_position);
+    }
+    else
+    {
+        printf("Stepper idle at position %d\n", pending_command.snapshot.current_position);
+    }
+    TASK_END(&pending_command.pt);
+}
+
+/*!
+ * @brief Resumable handler of stop_stepper decel, replies once the stepper has stopped
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: TASK_DONE once replied, TASK_WAITING otherwise
+ */
+static task_status_t command_stop_stepper_resume(stepper_state_t* stepper)
+{
+    TASK_BEGIN(&pending_command.pt);
+    TASK_WAIT_UNTIL(&pending_command.pt, command_wait_stopped(stepper));
+
+    if(stepper_is_estop_active(stepper))
+    {
+        printf("Error: stop_stepper aborted by estop at position %d\n", pending_command.snapshot.current_position);
+    }
+    else
+    {
+        printf("Stepper stopped at position %d\n", pending_command.snapshot.current_position);
+    }
+    TASK_END(&pending_command.pt);
+}
+
 char* process_stdin_input(void)
 {
     static bool lock = false;
@@ -249,22 +630,105 @@ char* process_stdin_input(void)
 /* bool function_name(stepper_state_t* stepper, bool value)                         */
 /* bool function_name(stepper_state_t* stepper, const char* command_string)         */
 /* bool function_name(const char* command_string)                                   */
+/* Helpers run in the stepper writer context so may read the state directly, but    */
+/* must update it through the stepper_* functions.                                  */
 /* ---------------------------------------------------------------------------------*/
 bool command_get_stepper_status(stepper_state_t* stepper)
 {
-    if( stepper == NULL )
+    stepper_snapshot_t snapshot;
+    start_input_status_t start_status;
+
+    if( stepper == NULL || !stepper_get_snapshot(stepper, &snapshot) )
     {
         printf("Error: Could not get stepper status\n");
         return false;
     }
 
     printf("Stepper Status:\n");
-    printf("  Current Position: %d\n", stepper->current_position);
-    printf("  Target Position: %d\n", stepper->target_position);
-    printf("  Step Period (us): %d\n", stepper->step_period * TIMER_INTERVAL_US);
-    printf("  Moving: %s\n", stepper->moving ? "Yes" : "No");
-    printf("  Enabled: %s\n", stepper->enabled ? "Yes" : "No");
-    printf("  Estop: %s\n", stepper_is_estop_active(stepper) ? "Active" : "Inactive");
+    printf("  Current Position: %d\n", snapshot.current_position);
+    printf("  Target Position: %d\n", snapshot.target_position);
+    printf("  Step Period (us): %d\n", snapshot.step_period * TIMER_INTERVAL_US);
+    printf("  Velocity (steps/s): %d\n", (int)(snapshot.direction == STEPPER_DIRECTION_FORWARD ? snapshot.velocity : -snapshot.velocity));
+    printf("  Acceleration (steps/s^2): %d\n", snapshot.acceleration);
+    printf("  Deceleration (steps/s^2): %d\n", snapshot.deceleration);
+    printf("  Feed Override: %d%%\n", snapshot.feed_override);
+    printf("  Moving: %s\n", snapshot.moving ? "Yes" : "No");
+    printf("  Enabled: %s\n", snapshot.enabled ? "Yes" : "No");
+    printf("  Estop: %s%s\n", stepper_is_estop_active(stepper) ? "Active" : "Inactive", snapshot.estop_stopping ? " (braking)" : "");
+    if(snapshot.estop_mode == STEPPER_ESTOP_MODE_DECEL)
+    {
+        printf("  Estop Mode: Decel (%d steps/s^2)\n", snapshot.estop_deceleration);
+    }
+    else
+    {
+        printf("  Estop Mode: Instant\n");
+    }
+    printf("  Backlash (steps): %d, slack %d\n", snapshot.backlash_steps, snapshot.backlash_slack);
+    if(snapshot.approach_mode == STEPPER_APPROACH_OFF)
+    {
+        printf("  Approach Mode: Off\n");
+    }
+    else
+    {
+        printf("  Approach Mode: %s (%d steps)%s\n", (snapshot.approach_mode == STEPPER_APPROACH_FORWARD) ? "Forward" : "Backward",
+               snapshot.approach_steps, snapshot.approach_pending ? " (overshooting)" : "");
+    }
+    for(int i = 0; i < STEPPER_MAX_SPEED_ZONES; i++)
+    {
+        if(snapshot.speed_zones[i].max_speed > 0)
+        {
+            printf("  Speed Zone %d: %d to %d at %d steps/s\n", i, snapshot.speed_zones[i].start,
+                   snapshot.speed_zones[i].end, snapshot.speed_zones[i].max_speed);
+        }
+    }
+    for(int i = 0; i < snapshot.accel_point_count; i++)
+    {
+        printf("  Accel Point %d: %d steps/s^2 at %d steps/s, stops in %d steps\n", i, snapshot.accel_points[i].acceleration,
+               snapshot.accel_points[i].speed, (int)ceilf(snapshot.accel_points[i].stop_distance));
+    }
+    if(snapshot.gear_enabled)
+    {
+        printf("  Gearing: %d:%d, external count %ld\n", snapshot.gear_numerator, snapshot.gear_denominator, (long)encoder_get_count());
+    }
+    else
+    {
+        printf("  Gearing: Off\n");
+    }
+    if(snapshot.track_enabled)
+    {
+        printf("  Tracking: Setpoint %d, %lu setpoints received\n", snapshot.track_setpoint, (unsigned long)snapshot.track_setpoints);
+    }
+    else
+    {
+        printf("  Tracking: Off\n");
+    }
+    for(int i = 0; i < STEPPER_MAX_TRIGGERS; i++)
+    {
+        const stepper_trigger_t* trigger = &snapshot.triggers[i];
+        if(trigger->pin != STEPPER_TRIGGER_UNUSED)
+        {
+            printf("  Trigger %d: pin %d for %d us at %d %s, fired %lu times\n", i, trigger->pin,
+                   trigger->pulse_ticks * TIMER_INTERVAL_US, trigger->position,
+                   (trigger->direction == STEPPER_TRIGGER_BOTH) ? "both ways" :
+                   (trigger->direction == STEPPER_DIRECTION_FORWARD) ? "forward" : "backward",
+                   (unsigned long)trigger->fire_count);
+        }
+    }
+    start_input_get_status(&start_status);
+    if(start_status.armed)
+    {
+        printf("  Start Input: %s %d on %s edge%s, %lu started, %lu missed, last latency %lu us\n",
+               (start_status.mode == START_MOVE_RELATIVE) ? "Relative" : "Absolute", start_status.steps,
+               (start_status.edge == START_INPUT_EDGE_RISING) ? "rising" : "falling", start_status.repeat ? " repeating" : "",
+               (unsigned long)start_status.starts, (unsigned long)start_status.missed, (unsigned long)start_status.last_latency_us);
+    }
+    else
+    {
+        printf("  Start Input: Off, %lu started, %lu missed, last latency %lu us\n", (unsigned long)start_status.starts,
+               (unsigned long)start_status.missed, (unsigned long)start_status.last_latency_us);
+    }
+    printf("  Move Plans: %lu cached, %lu planned, %lu retargeted\n", (unsigned long)snapshot.plan_hits,
+           (unsigned long)snapshot.plan_misses, (unsigned long)snapshot.plan_retargets);
     return true;
 }
 
@@ -280,22 +744,29 @@ bool command_claw_set_position(stepper_state_t* stepper, const char* cmd)
     // Check if stepper is enabled
     if(stepper->enabled == false)
     {
-        printf("Error: Stepper motor is disabled. Enable it first.\n");
+        command_reply("Error: Stepper motor is disabled. Enable it first.\n");
         return false;
     }
     // Check for valid position
     else if (position < 0 || position > 100)
     {
-        printf("Error: Claw position must be between 0 and 100\n");
+        command_reply("Error: Claw position must be between 0 and 100\n");
         return false;
     }
     // Set the target position as a percentage of max stepper position
     else
     {
         int new_stepper_position = (int)round((position * MAX_STEPPER_POSITION) / 100.0);
-        stepper_set_target_position(stepper, new_stepper_position);
-        stepper->moving = true; // Start moving
-        printf("Claw position set to %.2f%% (%d)\n", position, new_stepper_position);
+        // While tracking the position is a setpoint rather than a new move
+        if(stepper->track_enabled)
+        {
+            stepper_track_setpoint(stepper, new_stepper_position);
+        }
+        else
+        {
+            stepper_set_target_position(stepper, new_stepper_position);
+        }
+        command_reply("Claw position set to %.2f%% (%d)\n", position, new_stepper_position);
         return true;
     }
 }
@@ -327,164 +798,829 @@ bool command_set_stepper_period(stepper_state_t* stepper, const char* cmd)
     
     if(stepper_set_step_period(stepper, new_step_period))
     {
-        printf("Stepper step period set to %d us\n", new_step_period);
+        command_reply("Stepper step period set to %d us\n", new_step_period);
         return true;
     }
     else
     {
-        printf("Error: Invalid step period\n");
+        command_reply("Error: Invalid step period\n");
         return false;
     }
 }
 
-bool command_set_stepper_zero(stepper_state_t* stepper)
+bool command_set_stepper_accel(stepper_state_t* stepper, const char* cmd)
 {
+    int new_acceleration = atoi(cmd + strlen(SET_STEPPER_ACCEL_COMMAND));
+
     if( stepper == NULL )
     {
         return false;
     }
 
-    stepper->current_position = 0;
-    stepper->target_position = 0;
-    stepper->moving = false;
-    printf("Stepper position set to zero\n");
-    return true;
+    if(stepper_set_acceleration(stepper, new_acceleration))
+    {
+        command_reply("Stepper acceleration set to %d steps/s^2\n", new_acceleration);
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Acceleration must be between %d and %d steps/s^2\n", STEPPER_MIN_ACCELERATION, STEPPER_MAX_ACCELERATION);
+        return false;
+    }
 }
 
-bool command_move_stepper_absolute(stepper_state_t* stepper, const char* cmd)
+bool command_set_stepper_decel(stepper_state_t* stepper, const char* cmd)
 {
-    int target_position = atoi(cmd + strlen(MOVE_STEPPER_ABSOLUTE_COMMAND));
+    int new_deceleration = atoi(cmd + strlen(SET_STEPPER_DECEL_COMMAND));
 
     if( stepper == NULL )
     {
         return false;
     }
 
-    if(stepper->enabled == false)
-    {
-        printf("Error: Stepper motor is disabled. Enable it first.\n");
-        return false;
-    }
-
-    if(stepper_set_target_position(stepper, target_position))
+    if(stepper_set_deceleration(stepper, new_deceleration))
     {
-        printf("Moving stepper to absolute position %d\n", target_position);
-        stepper->moving = true;
+        command_reply("Stepper deceleration set to %d steps/s^2\n", new_deceleration);
         return true;
     }
     else
     {
-        printf("Error: Invalid target position\n");
+        command_reply("Error: Deceleration must be between %d and %d steps/s^2\n", STEPPER_MIN_ACCELERATION, STEPPER_MAX_ACCELERATION);
         return false;
     }
 }
 
-bool command_move_stepper_relative(stepper_state_t* stepper, const char* cmd)
+bool command_estop_mode(stepper_state_t* stepper, const char* cmd)
 {
-    int relative_steps = atoi(cmd + strlen(MOVE_STEPPER_RELATIVE_COMMAND));
-    int target_position = stepper->current_position + relative_steps;
+    const char* param = cmd + strlen(ESTOP_MODE_COMMAND);
+    int mode;
+    int deceleration;
 
     if( stepper == NULL )
     {
         return false;
     }
 
-    if(stepper->enabled == false)
+    if (strncmp(param, "instant", 7) == 0)
     {
-        printf("Error: Stepper motor is disabled. Enable it first.\n");
+        mode = STEPPER_ESTOP_MODE_INSTANT;
+        param += 7;
+    }
+    else if (strncmp(param, "decel", 5) == 0)
+    {
+        mode = STEPPER_ESTOP_MODE_DECEL;
+        param += 5;
+    }
+    else
+    {
+        command_reply("Error: Invalid parameter for estop_mode command. Use 'instant' or 'decel'.\n");
         return false;
     }
 
-    if(stepper_set_target_position(stepper, target_position))
+    // Deceleration is optional, keep the current value if not given
+    deceleration = (*param == ' ') ? atoi(param + 1) : stepper->estop_deceleration;
+
+    if(stepper_set_estop_mode(stepper, mode, deceleration))
     {
-        printf("Moving stepper to relative position %d\n", target_position);
-        stepper->moving = true;
+        if(mode == STEPPER_ESTOP_MODE_DECEL)
+        {
+            command_reply("Estop mode set to decel at %d steps/s^2, de-energised within %d ms\n", deceleration, STEPPER_ESTOP_STOP_TIMEOUT_MS);
+        }
+        else
+        {
+            command_reply("Estop mode set to instant\n");
+        }
         return true;
     }
     else
     {
-        printf("Error: Invalid target position\n");
+        command_reply("Error: Estop deceleration must be between %d and %d steps/s^2\n", STEPPER_MIN_ACCELERATION, STEPPER_MAX_ACCELERATION);
         return false;
     }
 }
 
-bool command_move_stepper_rotations(stepper_state_t* stepper, const char* cmd)
+bool command_set_backlash(stepper_state_t* stepper, const char* cmd)
 {
-    double relative_rotations = atof(cmd + strlen(MOVE_STEPPER_ROTATIONS_COMMAND));
-    int relative_steps = (int)round(relative_rotations * STEPPER_STEPS_PER_REV);
-    int target_position = stepper->current_position + relative_steps;
+    int steps = atoi(cmd + strlen(SET_BACKLASH_COMMAND));
 
     if( stepper == NULL )
     {
         return false;
     }
 
-    if(stepper->enabled == false)
-    {
-        printf("Error: Stepper motor is disabled. Enable it first.\n");
-        return false;
-    }
-
-    if(stepper_set_target_position(stepper, target_position))
+    if(stepper_set_backlash(stepper, steps))
     {
-        printf("Moving stepper by %+f rotations to position %d\n", relative_rotations, target_position);
-        stepper->moving = true;
+        command_reply("Backlash set to %d steps\n", steps);
         return true;
     }
     else
     {
-        printf("Error: Invalid target position\n");
+        command_reply("Error: Backlash must be between 0 and %d steps\n", STEPPER_MAX_BACKLASH_STEPS);
         return false;
     }
 }
 
-bool command_move_stepper_bump_down(stepper_state_t* stepper)
+bool command_approach_mode(stepper_state_t* stepper, const char* cmd)
 {
+    const char* param = cmd + strlen(APPROACH_MODE_COMMAND);
+    int mode;
+    int steps;
+
     if( stepper == NULL )
     {
         return false;
     }
 
-    if(stepper->enabled == false)
+    if (strncmp(param, "off", 3) == 0)
     {
-        printf("Error: Stepper motor is disabled. Enable it first.\n");
-        return false;
+        mode = STEPPER_APPROACH_OFF;
+        param += 3;
     }
-
-    // Check if bump down is within current limits
-    if(stepper->current_position > STEPPER_BUMP_STEPS)
+    else if (strncmp(param, "forward", 7) == 0)
     {
-        printf("Bumping stepper down by %d steps\n", STEPPER_BUMP_STEPS);
-        stepper->target_position = stepper->current_position - STEPPER_BUMP_STEPS; //
-        stepper->moving = true;
-        return true;
+        mode = STEPPER_APPROACH_FORWARD;
+        param += 7;
     }
-    // If bump down exceeds minimum position, reset to allow bump
-    else
+    else if (strncmp(param, "backward", 8) == 0)
     {
-        printf("Bump down exceeds minimum position, resetting zero to allow bump\n");
-        stepper->current_position = STEPPER_BUMP_STEPS;  // Set current position to allow bump down
-        stepper->target_position = 0; // Set target position to zero
-        stepper->moving = true;
-        return true;
+        mode = STEPPER_APPROACH_BACKWARD;
+        param += 8;
     }
-}
-
-bool command_stop_stepper(stepper_state_t* stepper)
-{
-    if( stepper == NULL )
+    else
     {
+        command_reply("Error: Invalid parameter for approach_mode command. Use 'off', 'forward' or 'backward'.\n");
         return false;
     }
 
-    if(stepper_stop(stepper))
+    // Overshoot is optional, keep the current value if not given
+    steps = (*param == ' ') ? atoi(param + 1) : stepper->approach_steps;
+
+    if(stepper_set_approach(stepper, mode, steps))
     {
-        printf("Stepper stopped at position %d\n", stepper->current_position);
+        if(mode == STEPPER_APPROACH_OFF)
+        {
+            command_reply("Approach mode set to off\n");
+        }
+        else
+        {
+            command_reply("Approach mode set to %s with %d steps overshoot\n", (mode == STEPPER_APPROACH_FORWARD) ? "forward" : "backward", steps);
+        }
         return true;
     }
     else
     {
-        printf("Error: Could not stop stepper\n");
+        command_reply("Error: Approach overshoot must be between 1 and %d steps\n", STEPPER_STEPS_PER_REV);
+        return false;
+    }
+}
+
+bool command_speed_zone(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(SPEED_ZONE_COMMAND);
+    char* end_ptr;
+    int index;
+    int start;
+    int end;
+    int max_speed;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    index = strtol(param, &end_ptr, 10);
+    if( end_ptr == param || *end_ptr != ' ' )
+    {
+        command_reply("Error: Invalid parameters for speed_zone command. Use '<n> <start> <end> <steps/s>' or '<n> off'.\n");
+        return false;
+    }
+    param = end_ptr + 1;
+
+    if( strncmp(param, "off", 3) == 0 )
+    {
+        start = 0;
+        end = 0;
+        max_speed = 0;
+    }
+    else
+    {
+        start = strtol(param, &end_ptr, 10);
+        end = strtol(end_ptr, &end_ptr, 10);
+        max_speed = strtol(end_ptr, &end_ptr, 10);
+        if( max_speed <= 0 )
+        {
+            command_reply("Error: Invalid parameters for speed_zone command. Use '<n> <start> <end> <steps/s>' or '<n> off'.\n");
+            return false;
+        }
+    }
+
+    if(stepper_set_speed_zone(stepper, index, start, end, max_speed))
+    {
+        if(max_speed == 0)
+        {
+            command_reply("Speed zone %d cleared\n", index);
+        }
+        else
+        {
+            command_reply("Speed zone %d set to %d steps/s from %d to %d\n", index, max_speed, start, end);
+        }
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Speed zone must be 0 to %d, within %d to %d, at most %d steps/s\n", STEPPER_MAX_SPEED_ZONES - 1,
+                      MIN_STEPPER_POSITION, MAX_STEPPER_POSITION, (int)STEPPER_MAX_SPEED);
+        return false;
+    }
+}
+
+bool command_accel_point(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(ACCEL_POINT_COMMAND);
+    char* end_ptr;
+    int index;
+    int speed;
+    int acceleration;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    index = strtol(param, &end_ptr, 10);
+    if( end_ptr == param || *end_ptr != ' ' )
+    {
+        command_reply("Error: Invalid parameters for accel_point command. Use '<n> <steps/s> <steps/s^2>' or '<n> off'.\n");
+        return false;
+    }
+    param = end_ptr + 1;
+
+    if( strncmp(param, "off", 3) == 0 )
+    {
+        speed = 0;
+        acceleration = 0;
+    }
+    else
+    {
+        speed = strtol(param, &end_ptr, 10);
+        acceleration = strtol(end_ptr, &end_ptr, 10);
+        if( acceleration <= 0 )
+        {
+            command_reply("Error: Invalid parameters for accel_point command. Use '<n> <steps/s> <steps/s^2>' or '<n> off'.\n");
+            return false;
+        }
+    }
+
+    if(stepper_set_accel_point(stepper, index, speed, acceleration))
+    {
+        if(acceleration == 0)
+        {
+            command_reply("Acceleration table cleared from point %d\n", index);
+        }
+        else
+        {
+            command_reply("Acceleration point %d set to %d steps/s^2 at %d steps/s\n", index, acceleration, speed);
+        }
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Points are added in increasing speed order up to %d steps/s, %d to %d steps/s^2, at most %d points\n",
+                      (int)STEPPER_MAX_SPEED, STEPPER_MIN_ACCELERATION, STEPPER_MAX_ACCELERATION, STEPPER_MAX_ACCEL_POINTS);
+        return false;
+    }
+}
+
+bool command_gear(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(GEAR_COMMAND);
+    char* end_ptr;
+    int numerator;
+    int denominator;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( strncmp(param, "off", 3) == 0 )
+    {
+        stepper_set_gearing(stepper, false, 0, 0, 0);
+        printf("Gearing off at position %d\n", stepper->current_position);
+        return true;
+    }
+
+    if(stepper->enabled == false)
+    {
+        printf("Error: Stepper motor is disabled. Enable it first.\n");
+        return false;
+    }
+
+    numerator = strtol(param, &end_ptr, 10);
+    denominator = strtol(end_ptr, &end_ptr, 10);
+
+    if(stepper_set_gearing(stepper, true, numerator, denominator, encoder_get_count()))
+    {
+        printf("Gearing %d:%d from position %d\n", numerator, denominator, stepper->current_position);
+        return true;
+    }
+    else
+    {
+        printf("Error: Gearing needs non zero steps and external steps from 1 to %d, magnitudes up to %d\n",
+               STEPPER_MAX_GEAR_RATIO, STEPPER_MAX_GEAR_RATIO);
+        return false;
+    }
+}
+
+bool command_track(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(TRACK_COMMAND);
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( strncmp(param, "on", 2) == 0 )
+    {
+        if(stepper->enabled == false)
+        {
+            printf("Error: Stepper motor is disabled. Enable it first.\n");
+            return false;
+        }
+        if(stepper_set_tracking(stepper, true))
+        {
+            printf("Tracking setpoints from position %d\n", stepper->current_position);
+            return true;
+        }
+        printf("Error: Cannot track while braking for an estop\n");
+        return false;
+    }
+    else if( strncmp(param, "off", 3) == 0 )
+    {
+        stepper_set_tracking(stepper, false);
+        printf("Tracking off, finishing at position %d\n", stepper->target_position);
+        return true;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for track command. Use 'on' or 'off'.\n");
+        return false;
+    }
+}
+
+bool command_track_setpoint(stepper_state_t* stepper, const char* cmd)
+{
+    char* end_ptr;
+    int setpoint;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    setpoint = strtol(cmd + 1, &end_ptr, 10);
+    if( end_ptr == cmd + 1 || *end_ptr != '\0' )
+    {
+        printf("Error: Invalid setpoint \"%s\"\n", cmd);
+        return false;
+    }
+
+    if(!stepper_track_setpoint(stepper, setpoint))
+    {
+        if(stepper->track_enabled)
+        {
+            printf("Error: Setpoint must be between %d and %d\n", MIN_STEPPER_POSITION, MAX_STEPPER_POSITION);
+        }
+        else
+        {
+            printf("Error: Tracking is off. Use 'track on' first.\n");
+        }
+        return false;
+    }
+
+    quiet_command = true;
+    return true;
+}
+
+/*!
+ * @brief Pins of the peripherals other than the stepper, never taken as trigger outputs
+ */
+static const int peripheral_pins[] =
+{
+    ENCODER_STEP_PIN,
+    ENCODER_DIR_PIN,
+    PROBE_PIN,
+    START_INPUT_PIN,
+    MODBUS_TX_PIN,
+    MODBUS_RX_PIN,
+};
+
+bool command_trigger(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(TRIGGER_COMMAND);
+    char* end_ptr;
+    int index;
+    int position = 0;
+    int pin = STEPPER_TRIGGER_UNUSED;
+    int pulse_us = 0;
+    int direction = STEPPER_TRIGGER_BOTH;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    index = strtol(param, &end_ptr, 10);
+    if( end_ptr == param || *end_ptr != ' ' )
+    {
+        printf("Error: Invalid parameters for trigger command. Use '<n> <position> <pin> <us> [forward|backward]' or '<n> off'.\n");
+        return false;
+    }
+    param = end_ptr + 1;
+
+    if( strncmp(param, "off", 3) != 0 )
+    {
+        position = strtol(param, &end_ptr, 10);
+        pin = strtol(end_ptr, &end_ptr, 10);
+        pulse_us = strtol(end_ptr, &end_ptr, 10);
+
+        // Direction is optional, fire both ways if not given
+        if( strncmp(end_ptr, " forward", 8) == 0 )
+        {
+            direction = STEPPER_DIRECTION_FORWARD;
+        }
+        else if( strncmp(end_ptr, " backward", 9) == 0 )
+        {
+            direction = STEPPER_DIRECTION_BACKWARD;
+        }
+        else if( *end_ptr != '\0' )
+        {
+            printf("Error: Invalid parameters for trigger command. Use '<n> <position> <pin> <us> [forward|backward]' or '<n> off'.\n");
+            return false;
+        }
+    }
+
+    // The stepper keeps its own pins, the other peripherals' pins are kept here
+    for(size_t i = 0; i < sizeof(peripheral_pins) / sizeof(peripheral_pins[0]); i++)
+    {
+        if(pin == peripheral_pins[i])
+        {
+            printf("Error: Pin %d is in use by another peripheral\n", pin);
+            return false;
+        }
+    }
+
+    if(stepper_set_trigger(stepper, index, position, pin, pulse_us, direction))
+    {
+        if(pin == STEPPER_TRIGGER_UNUSED)
+        {
+            printf("Trigger %d cleared\n", index);
+        }
+        else
+        {
+            printf("Trigger %d pulses pin %d for %d us at position %d\n", index, pin, pulse_us, position);
+        }
+        return true;
+    }
+    else
+    {
+        printf("Error: Trigger must be 0 to %d on a free pin up to %d, for %d to %d us\n", STEPPER_MAX_TRIGGERS - 1,
+               STEPPER_MAX_TRIGGER_PIN, TIMER_INTERVAL_US, STEPPER_MAX_TRIGGER_PULSE_US);
+        return false;
+    }
+}
+
+bool command_probe(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(PROBE_COMMAND);
+    probe_capture_t capture;
+    int edge;
+    bool stop;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if (strncmp(param, "arm ", 4) == 0)
+    {
+        param += 4;
+        if( strncmp(param, "rising", 6) == 0 )
+        {
+            edge = PROBE_EDGE_RISING;
+            param += 6;
+        }
+        else if( strncmp(param, "falling", 7) == 0 )
+        {
+            edge = PROBE_EDGE_FALLING;
+            param += 7;
+        }
+        else
+        {
+            printf("Error: Invalid edge for probe command. Use 'rising' or 'falling'.\n");
+            return false;
+        }
+
+        stop = (strncmp(param, " stop", 5) == 0);
+        probe_arm(stepper, edge, stop);
+        printf("Probe armed on %s edge of pin %d%s\n", (edge == PROBE_EDGE_RISING) ? "rising" : "falling",
+               PROBE_PIN, stop ? ", stopping the move" : "");
+        return true;
+    }
+    else if (strncmp(param, "disarm", 6) == 0)
+    {
+        if(probe_disarm())
+        {
+            printf("Probe disarmed\n");
+            return true;
+        }
+        printf("Error: Probe is not armed\n");
+        return false;
+    }
+    else if (strncmp(param, "read", 4) == 0)
+    {
+        probe_get_capture(&capture);
+        if(capture.triggered)
+        {
+            printf("Probe triggered at position %d, encoder %ld, time %lu us\n", capture.position,
+                   (long)capture.encoder_count, (unsigned long)capture.time_us);
+        }
+        else
+        {
+            printf("Probe %s, not triggered\n", capture.armed ? "armed" : "disarmed");
+        }
+        return true;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for probe command. Use 'arm <rising|falling> [stop]', 'disarm' or 'read'.\n");
+        return false;
+    }
+}
+
+bool command_arm_move(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(ARM_MOVE_COMMAND);
+    char* end_ptr;
+    int mode;
+    int steps;
+    int edge;
+    bool repeat;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( strncmp(param, "off", 3) == 0 )
+    {
+        if(start_input_disarm())
+        {
+            printf("Start input disarmed\n");
+            return true;
+        }
+        printf("Error: No move is armed\n");
+        return false;
+    }
+
+    if( strncmp(param, "absolute ", 9) == 0 )
+    {
+        mode = START_MOVE_ABSOLUTE;
+        param += 9;
+    }
+    else if( strncmp(param, "relative ", 9) == 0 )
+    {
+        mode = START_MOVE_RELATIVE;
+        param += 9;
+    }
+    else
+    {
+        printf("Error: Invalid parameters for arm_move command. Use '<absolute|relative> <steps> <rising|falling> [repeat]' or 'off'.\n");
+        return false;
+    }
+
+    steps = strtol(param, &end_ptr, 10);
+    if( strncmp(end_ptr, " rising", 7) == 0 )
+    {
+        edge = START_INPUT_EDGE_RISING;
+        end_ptr += 7;
+    }
+    else if( strncmp(end_ptr, " falling", 8) == 0 )
+    {
+        edge = START_INPUT_EDGE_FALLING;
+        end_ptr += 8;
+    }
+    else
+    {
+        printf("Error: Invalid parameters for arm_move command. Use '<absolute|relative> <steps> <rising|falling> [repeat]' or 'off'.\n");
+        return false;
+    }
+    repeat = (strncmp(end_ptr, " repeat", 7) == 0);
+
+    if(start_input_arm(mode, steps, edge, repeat))
+    {
+        printf("Move %s %d armed on %s edge of pin %d%s\n", (mode == START_MOVE_RELATIVE) ? "relative" : "absolute", steps,
+               (edge == START_INPUT_EDGE_RISING) ? "rising" : "falling", START_INPUT_PIN, repeat ? ", repeating" : "");
+        return true;
+    }
+    else
+    {
+        printf("Error: Absolute position must be between %d and %d\n", MIN_STEPPER_POSITION, MAX_STEPPER_POSITION);
+        return false;
+    }
+}
+
+bool command_feed_override(stepper_state_t* stepper, const char* cmd)
+{
+    int percent = atoi(cmd + strlen(FEED_OVERRIDE_COMMAND));
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(stepper_set_feed_override(stepper, percent))
+    {
+        command_reply("Feed override set to %d%%\n", percent);
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Feed override must be between %d and %d%%\n", STEPPER_MIN_FEED_OVERRIDE, STEPPER_MAX_FEED_OVERRIDE);
+        return false;
+    }
+}
+
+bool command_set_stepper_zero(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(!stepper_set_current_position(stepper, 0))
+    {
+        command_reply("Error: Stepper is moving. Stop it first.\n");
+        return false;
+    }
+    command_reply("Stepper position set to zero\n");
+    return true;
+}
+
+bool command_move_stepper_absolute(stepper_state_t* stepper, const char* cmd)
+{
+    int target_position = atoi(cmd + strlen(MOVE_STEPPER_ABSOLUTE_COMMAND));
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(stepper->enabled == false)
+    {
+        command_reply("Error: Stepper motor is disabled. Enable it first.\n");
+        return false;
+    }
+
+    if(stepper_set_target_position(stepper, target_position))
+    {
+        command_reply("Moving stepper to absolute position %d\n", target_position);
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Invalid target position\n");
+        return false;
+    }
+}
+
+bool command_move_stepper_relative(stepper_state_t* stepper, const char* cmd)
+{
+    int relative_steps = atoi(cmd + strlen(MOVE_STEPPER_RELATIVE_COMMAND));
+    int target_position = stepper->current_position + relative_steps;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(stepper->enabled == false)
+    {
+        command_reply("Error: Stepper motor is disabled. Enable it first.\n");
+        return false;
+    }
+
+    if(stepper_set_target_position(stepper, target_position))
+    {
+        command_reply("Moving stepper to relative position %d\n", target_position);
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Invalid target position\n");
+        return false;
+    }
+}
+
+bool command_move_stepper_rotations(stepper_state_t* stepper, const char* cmd)
+{
+    double relative_rotations = atof(cmd + strlen(MOVE_STEPPER_ROTATIONS_COMMAND));
+    int relative_steps = (int)round(relative_rotations * STEPPER_STEPS_PER_REV);
+    int target_position = stepper->current_position + relative_steps;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(stepper->enabled == false)
+    {
+        command_reply("Error: Stepper motor is disabled. Enable it first.\n");
+        return false;
+    }
+
+    if(stepper_set_target_position(stepper, target_position))
+    {
+        command_reply("Moving stepper by %+f rotations to position %d\n", relative_rotations, target_position);
+        return true;
+    }
+    else
+    {
+        command_reply("Error: Invalid target position\n");
+        return false;
+    }
+}
+
+bool command_move_stepper_bump_down(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(stepper->enabled == false)
+    {
+        printf("Error: Stepper motor is disabled. Enable it first.\n");
+        return false;
+    }
+
+    // Check if bump down is within current limits
+    if(stepper->current_position > STEPPER_BUMP_STEPS)
+    {
+        printf("Bumping stepper down by %d steps\n", STEPPER_BUMP_STEPS);
+        stepper_set_target_position(stepper, stepper->current_position - STEPPER_BUMP_STEPS);
+        return true;
+    }
+    // If bump down exceeds minimum position, reset to allow bump
+    else
+    {
+        if(!stepper_set_current_position(stepper, STEPPER_BUMP_STEPS))  // Set current position to allow bump down
+        {
+            printf("Error: Stepper is moving. Stop it first.\n");
+            return false;
+        }
+        printf("Bump down exceeds minimum position, resetting zero to allow bump\n");
+        stepper_set_target_position(stepper, 0); // Set target position to zero
+        return true;
+    }
+}
+
+bool command_stop_stepper(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(STOP_STEPPER_COMMAND);
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Controlled stop, the reply is deferred until the stepper has stopped
+    if(strncmp(param, " decel", 6) == 0)
+    {
+        if(!stepper_stop_decelerate(stepper))
+        {
+            printf("Error: Could not stop stepper\n");
+            return false;
+        }
+        if(stepper->moving)
+        {
+            command_defer(command_stop_stepper_resume, 0);
+            return true;
+        }
+        printf("Stepper stopped at position %d\n", stepper->current_position);
+        return true;
+    }
+
+    // Instant stop for emergencies, position may be lost at speed
+    if(stepper_stop(stepper))
+    {
+        printf("Stepper stopped at position %d\n", stepper->current_position);
+        return true;
+    }
+    else
+    {
+        printf("Error: Could not stop stepper\n");
         return false;
     }
 }
@@ -510,3 +1646,487 @@ bool command_set_echo(const char* cmd)
         return false;
     }
 }
+
+bool command_move_stats(const char* cmd)
+{
+    const char* param = cmd + strlen(MOVE_STATS_COMMAND);
+    move_stats_record_t record;
+    int count = MOVE_STATS_RECORDS;
+
+    if(strncmp(param, " clear", 6) == 0)
+    {
+        move_stats_clear();
+        printf("Move statistics cleared\n");
+        return true;
+    }
+
+    // Count is optional, all kept records are shown by default
+    if(*param == ' ')
+    {
+        count = atoi(param + 1);
+    }
+
+    if(count < 1 || count > MOVE_STATS_RECORDS)
+    {
+        printf("Error: Move statistics count must be between 1 and %d\n", MOVE_STATS_RECORDS);
+        return false;
+    }
+
+    if(!move_stats_get(0, &record))
+    {
+        printf("No moves recorded\n");
+        return true;
+    }
+
+    // Oldest first so the latest move is printed last
+    for(int age = count - 1; age >= 0; age--)
+    {
+        if(!move_stats_get(age, &record))
+        {
+            continue;
+        }
+        printf("Move %lu: %d to %d (target %d), %lu us (ideal %lu us), peak %d steps/s, %lu late ticks, worst %lu us%s%s%s\n",
+               (unsigned long)record.number, record.start_position, record.end_position, record.target_position,
+               (unsigned long)record.actual_us, (unsigned long)record.ideal_us, record.peak_speed,
+               (unsigned long)record.late_ticks, (unsigned long)record.max_late_us,
+               (record.flags & MOVE_STATS_RETARGET) ? ", retargeted" : "",
+               (record.flags & MOVE_STATS_ESTOP) ? ", estop" : "",
+               (record.flags & MOVE_STATS_FOLLOW) ? ", following" : "");
+    }
+    return true;
+}
+
+bool command_modbus(const char* cmd)
+{
+    const char* param = cmd + strlen(MODBUS_COMMAND);
+    modbus_status_t status;
+
+    if(strncmp(param, " address ", 9) == 0)
+    {
+        int address = atoi(param + 9);
+        if(!modbus_set_address(address))
+        {
+            printf("Error: Modbus address must be between 1 and %d\n", MODBUS_MAX_ADDRESS);
+            return false;
+        }
+        printf("Modbus address set to %d\n", address);
+        return true;
+    }
+    else if(*param != '\0')
+    {
+        printf("Error: Invalid parameter for modbus command. Use 'address <n>' or no parameter.\n");
+        return false;
+    }
+
+    modbus_get_status(&status);
+    printf("Modbus RTU address %d, %d baud 8E1: %lu requests, %lu replies, %lu exceptions, %lu CRC errors, %lu overruns\n",
+           status.address, MODBUS_BAUD, (unsigned long)status.requests, (unsigned long)status.replies,
+           (unsigned long)status.exceptions, (unsigned long)status.crc_errors, (unsigned long)status.overruns);
+    return true;
+}
+
+bool command_wait_idle(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(WAIT_IDLE_COMMAND);
+    int timeout_ms = 0;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Timeout is optional, no timeout waits until the move completes or estop
+    if(*param == ' ')
+    {
+        timeout_ms = atoi(param + 1);
+    }
+
+    if(timeout_ms < 0)
+    {
+        printf("Error: Invalid wait_idle timeout\n");
+        return false;
+    }
+
+    // A geared or tracked move never ends by itself, waiting on it would hold off all input
+    if(timeout_ms == 0 && (stepper->gear_enabled || stepper->track_enabled))
+    {
+        printf("Error: wait_idle needs a timeout while gearing or tracking\n");
+        return false;
+    }
+
+    if(stepper_is_estop_active(stepper))
+    {
+        printf("Error: wait_idle aborted by estop at position %d\n", stepper->current_position);
+        return false;
+    }
+
+    // Reply immediately if there is nothing to wait for
+    if(!stepper->moving)
+    {
+        printf("Stepper idle at position %d\n", stepper->current_position);
+        return true;
+    }
+
+    // Defer the reply until the resumed handler sees the move complete
+    command_defer(command_wait_idle_resume, timeout_ms);
+    return true;
+}
+
+bool command_wcet_report(void)
+{
+    if(wcet_report())
+    {
+        return true;
+    }
+    else
+    {
+        printf("Error: WCET measurement not built in, configure with -DCLAW_WCET=ON\n");
+        return false;
+    }
+}
+
+/*!
+ * @brief Check the stepper is stopped before a long dump
+ *
+ * @note: A dump prints from the millisecond task and holds off the ten microsecond tasks
+ *        until it is done, so during a move it would stall the step engine.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if stopped, false after an error reply if moving
+ */
+static bool command_dump_allowed(const stepper_state_t* stepper)
+{
+    if(stepper->moving)
+    {
+        printf("Error: Stepper is moving, dump once it has stopped\n");
+        return false;
+    }
+    return true;
+}
+
+bool command_profile(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(PROFILE_COMMAND);
+
+    if (strncmp(param, "start", 5) == 0)
+    {
+        if(profiler_start())
+        {
+            printf("Profiler started\n");
+            return true;
+        }
+        printf("Error: No hardware alarm available for the profiler\n");
+        return false;
+    }
+    else if (strncmp(param, "stop", 4) == 0)
+    {
+        if(profiler_stop())
+        {
+            printf("Profiler stopped\n");
+            return true;
+        }
+        printf("Error: Profiler is not running\n");
+        return false;
+    }
+    else if (strncmp(param, "dump", 4) == 0)
+    {
+        if(!command_dump_allowed(stepper))
+        {
+            return false;
+        }
+        if(profiler_dump())
+        {
+            return true;
+        }
+        printf("Error: No profiler samples\n");
+        return false;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for profile command. Use 'start', 'stop' or 'dump'.\n");
+        return false;
+    }
+}
+
+bool command_record(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(RECORD_COMMAND);
+
+    if (strncmp(param, "start", 5) == 0)
+    {
+        session_record_start();
+        printf("Session recording started\n");
+        return true;
+    }
+    else if (strncmp(param, "stop", 4) == 0)
+    {
+        if(session_record_stop())
+        {
+            printf("Session recording stopped\n");
+            return true;
+        }
+        printf("Error: Session recording is not active\n");
+        return false;
+    }
+    else if (strncmp(param, "dump", 4) == 0)
+    {
+        if(!command_dump_allowed(stepper))
+        {
+            return false;
+        }
+        if(session_dump())
+        {
+            return true;
+        }
+        printf("Error: No session recorded\n");
+        return false;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for record command. Use 'start', 'stop' or 'dump'.\n");
+        return false;
+    }
+}
+
+bool command_capture(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(CAPTURE_COMMAND);
+
+    if (strncmp(param, "start ", 6) == 0)
+    {
+        int rate_hz = atoi(param + 6);
+        if(capture_start(rate_hz))
+        {
+            printf("Capture started at %d Hz\n", rate_hz);
+            return true;
+        }
+        printf("Error: Capture rate must be between 1 and %d Hz\n", CAPTURE_MAX_RATE_HZ);
+        return false;
+    }
+    else if (strncmp(param, "stop", 4) == 0)
+    {
+        if(capture_stop())
+        {
+            printf("Capture stopped\n");
+            return true;
+        }
+        printf("Error: Capture is not running\n");
+        return false;
+    }
+    else if (strncmp(param, "dump", 4) == 0)
+    {
+        if(!command_dump_allowed(stepper))
+        {
+            return false;
+        }
+        if(capture_dump())
+        {
+            return true;
+        }
+        printf("Error: No samples captured\n");
+        return false;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for capture command. Use 'start <hz>', 'stop' or 'dump'.\n");
+        return false;
+    }
+}
+
+bool command_log(stepper_state_t* stepper, const char* cmd)
+{
+    const char* param = cmd + strlen(LOG_COMMAND);
+
+    if (strncmp(param, "text", 4) == 0)
+    {
+        if(!command_dump_allowed(stepper))
+        {
+            return false;
+        }
+        if(event_log_print())
+        {
+            return true;
+        }
+        printf("Error: Event log is empty\n");
+        return false;
+    }
+    else if (strncmp(param, "dump", 4) == 0)
+    {
+        if(!command_dump_allowed(stepper))
+        {
+            return false;
+        }
+        if(event_log_dump())
+        {
+            return true;
+        }
+        printf("Error: Event log is empty\n");
+        return false;
+    }
+    else if (strncmp(param, "clear", 5) == 0)
+    {
+        event_log_clear();
+        printf("Event log cleared\n");
+        return true;
+    }
+    else
+    {
+        printf("Error: Invalid parameter for log command. Use 'text', 'dump' or 'clear'.\n");
+        return false;
+    }
+}
+
+static bool command_batch_set_zero(stepper_state_t* stepper, const char* cmd)
+{
+    (void)cmd;
+    return command_set_stepper_zero(stepper);
+}
+
+static bool command_batch_enable(stepper_state_t* stepper, const char* cmd)
+{
+    (void)cmd;
+    return stepper_enable(stepper, true);
+}
+
+static bool command_batch_disable(stepper_state_t* stepper, const char* cmd)
+{
+    (void)cmd;
+    return stepper_enable(stepper, false);
+}
+
+/*!
+ * @brief Commands that may be batched, those that only change the stepper state
+ *
+ * The handlers check the batch on the scratch state, without the WCET measurements of
+ * command_dispatch(). They reply through command_reply().
+ */
+typedef bool (*batch_handler_t)(stepper_state_t* stepper, const char* cmd);
+
+typedef struct batch_command
+{
+    const char* name;           //!< Command prefix
+    batch_handler_t handler;    //!< Handler to check it with
+} batch_command_t;
+
+static const batch_command_t batch_commands[] =
+{
+    { CLAW_SET_POSITION_COMMAND,      command_claw_set_position },
+    { SET_STEPPER_PERIOD_COMMAND,     command_set_stepper_period },
+    { SET_STEPPER_ACCEL_COMMAND,      command_set_stepper_accel },
+    { SET_STEPPER_DECEL_COMMAND,      command_set_stepper_decel },
+    { FEED_OVERRIDE_COMMAND,          command_feed_override },
+    { ESTOP_MODE_COMMAND,             command_estop_mode },
+    { SET_BACKLASH_COMMAND,           command_set_backlash },
+    { APPROACH_MODE_COMMAND,          command_approach_mode },
+    { SPEED_ZONE_COMMAND,             command_speed_zone },
+    { ACCEL_POINT_COMMAND,            command_accel_point },
+    { SET_STEPPER_ZERO_COMMAND,       command_batch_set_zero },
+    { MOVE_STEPPER_ABSOLUTE_COMMAND,  command_move_stepper_absolute },
+    { MOVE_STEPPER_RELATIVE_COMMAND,  command_move_stepper_relative },
+    { MOVE_STEPPER_ROTATIONS_COMMAND, command_move_stepper_rotations },
+    { ENABLE_STEPPER_COMMAND,         command_batch_enable },
+    { DISABLE_STEPPER_COMMAND,        command_batch_disable },
+};
+
+#define BATCH_COMMAND_COUNT             (int)(sizeof(batch_commands) / sizeof(batch_commands[0]))
+
+bool command_batch(stepper_state_t* stepper, const char* cmd)
+{
+    static char batch_buffer[MAX_COMMAND_LENGTH];
+    char* commands[MAX_BATCH_COMMANDS];
+    batch_handler_t handlers[MAX_BATCH_COMMANDS];
+    stepper_state_t* scratch;
+    int count = 0;
+    int failed;
+    char* next;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Split the line, trimming the spaces around each command
+    strncpy(batch_buffer, cmd, sizeof(batch_buffer) - 1);
+    batch_buffer[sizeof(batch_buffer) - 1] = '\0';
+    next = batch_buffer;
+    while(next != NULL)
+    {
+        char* command = next;
+        char* end;
+        int index;
+
+        next = strchr(command, BATCH_SEPARATOR);
+        if(next != NULL)
+        {
+            *next++ = '\0';
+        }
+        while(*command == ' ')
+        {
+            command++;
+        }
+        end = command + strlen(command);
+        while(end > command && end[-1] == ' ')
+        {
+            *--end = '\0';
+        }
+
+        // A trailing separator is allowed, empty commands elsewhere are not
+        if(*command == '\0')
+        {
+            if(next == NULL && count > 0)
+            {
+                break;
+            }
+            printf("Error: Empty command in batch\n");
+            return false;
+        }
+        if(count >= MAX_BATCH_COMMANDS)
+        {
+            printf("Error: Batch has more than %d commands\n", MAX_BATCH_COMMANDS);
+            return false;
+        }
+
+        for(index = 0; index < BATCH_COMMAND_COUNT; index++)
+        {
+            if(strncmp(command, batch_commands[index].name, strlen(batch_commands[index].name)) == 0)
+            {
+                break;
+            }
+        }
+        if(index == BATCH_COMMAND_COUNT)
+        {
+            printf("Error: \"%s\" cannot be batched\n", command);
+            return false;
+        }
+        handlers[count] = batch_commands[index].handler;
+        commands[count++] = command;
+    }
+
+    // Check the whole batch on a scratch copy of the state, nothing reaches the stepper
+    scratch = stepper_scratch_copy(stepper);
+    batch_checking = true;
+    for(failed = 0; failed < count; failed++)
+    {
+        batch_reply[0] = '\0';
+        if(!handlers[failed](scratch, commands[failed]))
+        {
+            break;
+        }
+    }
+    batch_checking = false;
+
+    if(failed < count)
+    {
+        // The reply of the failing command holds its error against the state it saw
+        printf("%s", batch_reply);
+        printf("Error: Batch rejected at command %d, no command applied\n", failed + 1);
+        return false;
+    }
+
+    // Apply the batch within this tick, the step engine sees all of it or none of it
+    for(int i = 0; i < count; i++)
+    {
+        command_dispatch(commands[i], stepper);
+    }
+    return true;
+}
@@ -39,6 +39,39 @@ bool process_command(const char* cmd, stepper_state_t* stepper);
  */
 char* process_stdin_input(void);
 
+/*!
+ * @brief Check whether a command reply has been deferred
+ *
+ * @note: While a command is pending no further input is read, the
+ *        reply and prompt are printed once the command completes.
+ *
+ * @param: none
+ * @return: true if a deferred command is outstanding, false otherwise
+ */
+bool command_is_pending(void);
+
+/*!
+ * @brief Check whether the last command completed without a reply
+ *
+ * @note: Tracking setpoints are not answered, nor followed by a prompt, so a
+ *        fast setpoint stream does not fill the serial link with replies.
+ *
+ * @param: none
+ * @return: true if no prompt should follow the last command, false otherwise
+ */
+bool command_is_quiet(void);
+
+/*!
+ * @brief Process a deferred command
+ *
+ * @note: Called every millisecond, resumes the handler of the deferred command, which
+ *        prints its reply once the completion condition, estop or timeout is reached.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if a deferred command completed on this call, false otherwise
+ */
+bool process_pending_command(stepper_state_t* stepper);
+
 /*!
  * @brief Command helper function to set claw position
  *
@@ -71,6 +104,191 @@ bool command_set_led_period(const char* cmd);
  */
 bool command_set_stepper_period(stepper_state_t* stepper, const char* cmd);
 
+/*!
+ * @brief Command helper function to set stepper acceleration
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_set_stepper_accel(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set stepper deceleration
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_set_stepper_decel(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set the estop mode
+ *
+ * In instant mode the estop de-energises the stepper at once. In decel mode a moving
+ * stepper brakes at the estop deceleration with holding torque and is de-energised once
+ * stopped, or after STEPPER_ESTOP_STOP_TIMEOUT_MS, so the position is kept.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_estop_mode(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set the backlash compensation
+ *
+ * Each reversal inserts this many steps before the position changes, to take up the
+ * backlash in the lead screw. The backlash is assumed taken up in the last direction.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_set_backlash(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set the unidirectional approach mode
+ *
+ * With forward or backward set, targets that would be reached travelling the other way
+ * are overshot first, so the backlash is always taken up on the same side at the end.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_approach_mode(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set or clear a speed limit zone
+ *
+ * Moves run at full speed outside the zones and are slowed before entering one, so
+ * only the part of the stroke that needs a gentle approach is run slowly.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_speed_zone(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set or clear a point on the acceleration table
+ *
+ * The table gives the acceleration available against speed, from the motor torque curve,
+ * and replaces the fixed acceleration and deceleration while it has any points.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_accel_point(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to engage or disengage electronic gearing
+ *
+ * The stepper follows the external step/dir input counted by the encoder module at a
+ * ratio of stepper steps to external steps, e.g. to track a conveyor without the host.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_gear(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set or clear a position synchronised output trigger
+ *
+ * The step engine pulses the pin on the tick it steps onto the position, e.g. to fire a
+ * camera or vacuum valve mid-move without the latency of polling from the host.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_trigger(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to arm, disarm or read the touch probe
+ *
+ * The probe edge latches the step position and external count from an interrupt, and
+ * can brake the move in progress to a stop, e.g. to find the height of a part.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_probe(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to arm or disarm a move started by the start input
+ *
+ * The move starts on the 10 us tick after the input edge, without waiting for the host
+ * to send a command over USB.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_arm_move(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to engage or disengage setpoint tracking
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_track(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to give setpoint tracking a new setpoint
+ *
+ * A line of '@' followed by the setpoint in steps, e.g. "@12000", sent with echo off
+ * at up to the command input rate. Only an error is answered.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_track_setpoint(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to set the feed rate override
+ *
+ * The speed of a move in progress ramps to the new rate without stopping.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_feed_override(stepper_state_t* stepper, const char* cmd);
+
 /*!
  * @brief Command helper function to set stepper position to zero
  *
@@ -123,10 +341,17 @@ bool command_move_stepper_bump_down(stepper_state_t* stepper);
 /*!
  * @brief Command helper function to stop stepper movement
  *
+ * Stops instantly by default. With the decel parameter the stepper ramps down at the
+ * configured deceleration and the reply, with the final position, is deferred until
+ * it has stopped.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
  * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
  * @return: true on success, false on failure
  */
-bool command_stop_stepper(stepper_state_t* stepper);
+bool command_stop_stepper(stepper_state_t* stepper, const char* cmd);
 
 /*!
  * @brief Command helper function to get stepper status
@@ -148,4 +373,109 @@ bool command_get_stepper_status(stepper_state_t* stepper);
  */
 bool command_set_echo(const char* cmd);
 
+/*!
+ * @brief Command helper function to show or clear the per move statistics
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_move_stats(const char* cmd);
+
+/*!
+ * @brief Command helper function to show the Modbus server counters or set its address
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_modbus(const char* cmd);
+
+/*!
+ * @brief Command helper function to wait for the stepper to become idle
+ *
+ * The reply is deferred until the stepper stops moving, the estop becomes
+ * active or the optional timeout in milliseconds expires.
+ *
+ * @note: Function is not completely safe, assumes valid command string
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_wait_idle(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to report worst case execution times
+ *
+ * @param: none
+ * @return: true on success, false if measurement is not built in
+ */
+bool command_wcet_report(void);
+
+/*!
+ * @brief Command helper function to control the sampling profiler
+ *
+ * @note: Function is not completely safe, assumes valid command string. Dumps are
+ *        refused while the stepper is moving.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_profile(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to record command sessions for host replay
+ *
+ * @note: Function is not completely safe, assumes valid command string. Dumps are
+ *        refused while the stepper is moving.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_record(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to capture move profiles and dump them compressed
+ *
+ * @note: Function is not completely safe, assumes valid command string. Dumps are
+ *        refused while the stepper is moving.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_capture(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to print or clear the event log
+ *
+ * @note: Function is not completely safe, assumes valid command string. Dumps are
+ *        refused while the stepper is moving.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true on success, false on failure
+ */
+bool command_log(stepper_state_t* stepper, const char* cmd);
+
+/*!
+ * @brief Command helper function to check and apply several commands from one line
+ *
+ * @note: The commands are separated by ';'. Only commands that change the stepper state
+ *        may be batched. All of them are first checked in one pass on the scratch copy of
+ *        the state, with their replies held back, and only if every one succeeds are they
+ *        run again on the stepper, in the same tick, with their replies. Otherwise the
+ *        held back error of the failing command is shown.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param cmd: pointer to command string
+ * @return: true if the batch was applied, false if it was rejected
+ */
+bool command_batch(stepper_state_t* stepper, const char* cmd);
+
 #endif // COMMAND_PROCESSOR_H
@@ -0,0 +1,60 @@
+/**
+    * @file encoder.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Implementation of the external step/dir pulse counter
+    * 
+    * The PIO program in encoder.pio writes the count to RX FIFO register 0 after every
+    * edge, so reading is a single register load of the latest count, never a stale one.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "encoder.h"
+#include "encoder.pio.h"
+
+static PIO encoder_pio = NULL;
+static uint encoder_sm = 0;
+
+bool encoder_init(void)
+{
+    int sm;
+    uint offset;
+
+    if( encoder_pio != NULL )
+    {
+        return true;
+    }
+
+    sm = pio_claim_unused_sm(pio0, false);
+    if( sm < 0 )
+    {
+        return false;
+    }
+
+    if( !pio_can_add_program(pio0, &step_dir_counter_program) )
+    {
+        pio_sm_unclaim(pio0, sm);
+        return false;
+    }
+
+    offset = pio_add_program(pio0, &step_dir_counter_program);
+    step_dir_counter_program_init(pio0, sm, offset, ENCODER_STEP_PIN, ENCODER_DIR_PIN);
+
+    encoder_sm = sm;
+    encoder_pio = pio0;
+    return true;
+}
+
+int32_t encoder_get_count(void)
+{
+    if( encoder_pio == NULL )
+    {
+        return 0;
+    }
+
+    // One 32 bit load, so a read from the probe interrupt cannot tear a read in progress
+    return (int32_t)encoder_pio->rxf_putget[encoder_sm][0];
+}
@@ -0,0 +1,40 @@
+/**
+    * @file encoder.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the external step/dir pulse counter
+    * 
+    * A PIO state machine counts the step/dir pulse stream of an external axis so the
+    * stepper can follow it through electronic gearing without any CPU time per pulse.
+*/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ENCODER_STEP_PIN                    10      // GPIO pin for the external step input
+#define ENCODER_DIR_PIN                     11      // GPIO pin for the external dir input, high counts up
+
+/*!
+ * @brief Load the counter program and start counting from zero
+ *
+ * @param: none
+ * @return: true on success, false if no PIO state machine or program space is free
+ */
+bool encoder_init(void);
+
+/*!
+ * @brief Get the latest count of the external axis
+ *
+ * @note: The count wraps, take differences between counts as int32_t. Safe to call from an interrupt.
+ *
+ * @param: none
+ * @return: count in external steps, 0 if the counter is not running
+ */
+int32_t encoder_get_count(void);
+
+#endif // ENCODER_H
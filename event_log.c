@@ -0,0 +1,153 @@
+/**
+    * @file event_log.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the deferred format event log
+    * 
+    * This file contains the record ring and the write, dump and print functions.
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "event_log.h"
+
+/*!
+ * @brief One logged event
+ */
+typedef struct event_log_record
+{
+    const char* format;                 //!< Format string, in flash
+    uint32_t time_us;                   //!< Time of the event in microseconds
+    uint32_t count;                     //!< Number of arguments
+    uint32_t args[EVENT_LOG_MAX_ARGS];  //!< Raw arguments
+} event_log_record_t;
+
+const char event_log_format_base[] = "claw event log";
+
+static event_log_record_t event_log_records[EVENT_LOG_RECORDS];
+static uint32_t event_log_head = 0;
+static uint32_t event_log_count = 0;
+static uint32_t event_log_overwritten = 0;
+
+/* -------------------------- event log functions -----------------------------*/
+void event_log_write(const char* format, int count, ...)
+{
+    event_log_record_t* record;
+    uint32_t interrupts;
+    va_list args;
+
+    // Claim the slot with interrupts off so a handler logging at the same time gets the next one
+    interrupts = save_and_disable_interrupts();
+    record = &event_log_records[event_log_head];
+    event_log_head = (event_log_head + 1) & (EVENT_LOG_RECORDS - 1);
+    if( event_log_count < EVENT_LOG_RECORDS )
+    {
+        event_log_count++;
+    }
+    else
+    {
+        event_log_overwritten++;
+    }
+
+    record->format = format;
+    record->time_us = time_us_32();
+    record->count = (count < EVENT_LOG_MAX_ARGS) ? count : EVENT_LOG_MAX_ARGS;
+    va_start(args, count);
+    for(uint32_t i = 0; i < EVENT_LOG_MAX_ARGS; i++)
+    {
+        record->args[i] = (i < record->count) ? va_arg(args, unsigned int) : 0;
+    }
+    va_end(args);
+    restore_interrupts(interrupts);
+}
+
+/*!
+ * @brief Find the oldest record
+ *
+ * @param count: returns the number of records
+ * @return: ring index of the oldest record
+ */
+static uint32_t event_log_oldest(uint32_t* count)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    uint32_t index = (event_log_head - event_log_count) & (EVENT_LOG_RECORDS - 1);
+    *count = event_log_count;
+    restore_interrupts(interrupts);
+    return index;
+}
+
+/*!
+ * @brief Copy a record out of the ring
+ *
+ * @note: Events logged while printing may overwrite the oldest records first.
+ *
+ * @param index: ring index, wrapped
+ * @param record: pointer to the structure to fill
+ * @return: none
+ */
+static void event_log_get(uint32_t index, event_log_record_t* record)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    *record = event_log_records[index & (EVENT_LOG_RECORDS - 1)];
+    restore_interrupts(interrupts);
+}
+
+bool event_log_dump(void)
+{
+    event_log_record_t record;
+    uint32_t count;
+    uint32_t oldest = event_log_oldest(&count);
+
+    if( count == 0 )
+    {
+        return false;
+    }
+
+    printf("# claw log: %lu records, %lu overwritten\n", (unsigned long)count, (unsigned long)event_log_overwritten);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        event_log_get(oldest + i, &record);
+        printf("%08lx %08lx", (unsigned long)(uint32_t)(record.format - event_log_format_base), (unsigned long)record.time_us);
+        for(uint32_t j = 0; j < record.count; j++)
+        {
+            printf(" %08lx", (unsigned long)record.args[j]);
+        }
+        printf("\n");
+    }
+    printf("# end of log\n");
+    return true;
+}
+
+bool event_log_print(void)
+{
+    event_log_record_t record;
+    uint32_t count;
+    uint32_t oldest = event_log_oldest(&count);
+
+    if( count == 0 )
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        event_log_get(oldest + i, &record);
+        printf("%10lu ", (unsigned long)record.time_us);
+        // Unused arguments are passed as zero and ignored by the format
+        printf(record.format, record.args[0], record.args[1], record.args[2], record.args[3]);
+        printf("\n");
+    }
+    return true;
+}
+
+void event_log_clear(void)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    event_log_count = 0;
+    event_log_overwritten = 0;
+    restore_interrupts(interrupts);
+}
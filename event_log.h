@@ -0,0 +1,81 @@
+/**
+    * @file event_log.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the deferred format event log
+    * 
+    * EVENT_LOG() stores a reference to its format string, a timestamp and the raw arguments
+    * in a RAM ring instead of formatting them, so it is cheap enough for the step engine,
+    * the command path and interrupt handlers. The dump prints one hex line per record:
+    *
+    *   # claw log: <n> records, <m> overwritten
+    *   <format id> <time_us> [<argument> ...]
+    *   # end of log
+    *
+    * The format id is the offset of the format string from event_log_format_base, so the
+    * host tool sim/claw_logfmt.c can find the string in the ELF file of the same build and
+    * format the record there. Arguments must be 32 bit integers (%d, %i, %u, %x, %X, %c),
+    * at most EVENT_LOG_MAX_ARGS of them.
+*/
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_LOG_RECORDS                   256     // Records kept in the ring, a power of 2
+#define EVENT_LOG_MAX_ARGS                  4       // Most arguments stored with a record
+
+/*!
+ * @brief Symbol the format ids are relative to, looked up by the host tool
+ */
+extern const char event_log_format_base[];
+
+// Count the arguments after the format, up to EVENT_LOG_MAX_ARGS
+#define EVENT_LOG_COUNT(...)                EVENT_LOG_COUNT_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define EVENT_LOG_COUNT_(z, a, b, c, d, n, ...) n
+
+/*!
+ * @brief Log an event, e.g. EVENT_LOG("Move done at %d", position)
+ */
+#define EVENT_LOG(format, ...)              event_log_write(format, EVENT_LOG_COUNT(__VA_ARGS__), ##__VA_ARGS__)
+
+/*!
+ * @brief Store a record in the ring, use EVENT_LOG() rather than calling this directly
+ *
+ * @note: Safe to call from an interrupt. The oldest record is overwritten when full.
+ *
+ * @param format: pointer to a string literal format, only the reference is stored
+ * @param count: number of 32 bit integer arguments that follow
+ * @return: none
+ */
+void event_log_write(const char* format, int count, ...);
+
+/*!
+ * @brief Print the records as hex for formatting on the host
+ *
+ * @param: none
+ * @return: true on success, false if the log is empty
+ */
+bool event_log_dump(void);
+
+/*!
+ * @brief Format and print the records on the device
+ *
+ * @param: none
+ * @return: true on success, false if the log is empty
+ */
+bool event_log_print(void);
+
+/*!
+ * @brief Discard all records
+ *
+ * @param: none
+ * @return: none
+ */
+void event_log_clear(void);
+
+#endif // EVENT_LOG_H
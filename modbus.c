@@ -0,0 +1,551 @@
+/**
+    * @file modbus.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the Modbus RTU server
+    *
+    * This file contains the UART polling, the register tables and the request handling.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "sys_timer.h"
+#include "modbus.h"
+
+#define MODBUS_UART                         uart0
+#define MODBUS_T35_US                       ((MODBUS_BAUD > 19200) ? 1750 : (38500000 / MODBUS_BAUD))
+
+#define MODBUS_READ_HOLDING                 3
+#define MODBUS_READ_INPUT                   4
+#define MODBUS_WRITE_SINGLE                 6
+#define MODBUS_WRITE_MULTIPLE               16
+
+#define MODBUS_EXCEPTION_FUNCTION           1       // Function not supported
+#define MODBUS_EXCEPTION_ADDRESS            2       // Register not mapped, not writable or a 32 bit value split
+#define MODBUS_EXCEPTION_VALUE              3       // Malformed request or value refused
+#define MODBUS_EXCEPTION_BUSY               6       // State being updated, try again
+
+#define MODBUS_MAX_READ                     125     // Most registers in one read
+#define MODBUS_MAX_WRITE                    123     // Most registers in one write
+
+/*!
+ * @brief Register read and write functions, values are sign extended to 32 bits
+ */
+typedef int32_t (*modbus_read_t)(stepper_state_t* stepper, const stepper_snapshot_t* snapshot);
+typedef bool (*modbus_write_t)(stepper_state_t* stepper, int32_t value);
+
+/*!
+ * @brief One entry of a register table
+ */
+typedef struct modbus_register
+{
+    uint16_t address;       //!< First register address
+    uint16_t words;         //!< 1, or 2 for a 32 bit value high word first
+    modbus_read_t read;     //!< Read function
+    modbus_write_t write;   //!< Write function, NULL if read only
+} modbus_register_t;
+
+static uint8_t modbus_rx[MODBUS_FRAME_SIZE];
+static int modbus_rx_count = 0;
+static uint32_t modbus_rx_last_us = 0;
+static bool modbus_rx_overrun = false;
+static bool modbus_frame_ready = false;
+
+static uint8_t modbus_tx[MODBUS_FRAME_SIZE];
+static int modbus_tx_count = 0;
+static int modbus_tx_index = 0;
+
+static uint16_t modbus_crc_table[256];
+static modbus_status_t modbus_status = { MODBUS_DEFAULT_ADDRESS, 0, 0, 0, 0, 0 };
+
+/* -------------------------- register functions -----------------------------*/
+static int32_t modbus_read_status(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    int32_t status = 0;
+
+    status |= snapshot->moving ? MODBUS_STATUS_MOVING : 0;
+    status |= snapshot->enabled ? MODBUS_STATUS_ENABLED : 0;
+    status |= stepper_is_estop_active(stepper) ? MODBUS_STATUS_ESTOP : 0;
+    status |= snapshot->estop_stopping ? MODBUS_STATUS_ESTOP_STOPPING : 0;
+    status |= snapshot->gear_enabled ? MODBUS_STATUS_GEAR : 0;
+    status |= snapshot->track_enabled ? MODBUS_STATUS_TRACK : 0;
+    return status;
+}
+
+static int32_t modbus_read_position(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->current_position;
+}
+
+static int32_t modbus_read_target(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->target_position;
+}
+
+static int32_t modbus_read_velocity(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return (int32_t)((snapshot->direction == STEPPER_DIRECTION_FORWARD) ? snapshot->velocity : -snapshot->velocity);
+}
+
+static int32_t modbus_read_step_period(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->step_period * TIMER_INTERVAL_US;
+}
+
+static int32_t modbus_read_acceleration(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->acceleration;
+}
+
+static int32_t modbus_read_deceleration(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->deceleration;
+}
+
+static int32_t modbus_read_feed_override(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    return snapshot->feed_override;
+}
+
+static int32_t modbus_read_zero(stepper_state_t* stepper, const stepper_snapshot_t* snapshot)
+{
+    (void)stepper;
+    (void)snapshot;
+    return 0;
+}
+
+static bool modbus_write_step_period(stepper_state_t* stepper, int32_t value)
+{
+    return stepper_set_step_period(stepper, value);
+}
+
+static bool modbus_write_acceleration(stepper_state_t* stepper, int32_t value)
+{
+    return stepper_set_acceleration(stepper, value);
+}
+
+static bool modbus_write_deceleration(stepper_state_t* stepper, int32_t value)
+{
+    return stepper_set_deceleration(stepper, value);
+}
+
+static bool modbus_write_feed_override(stepper_state_t* stepper, int32_t value)
+{
+    return stepper_set_feed_override(stepper, value);
+}
+
+static bool modbus_write_target(stepper_state_t* stepper, int32_t value)
+{
+    // Same rule as the move commands, no moves while disabled
+    if( !stepper->enabled )
+    {
+        return false;
+    }
+    return stepper_set_target_position(stepper, value);
+}
+
+static bool modbus_write_command(stepper_state_t* stepper, int32_t value)
+{
+    switch(value)
+    {
+        case MODBUS_COMMAND_ENABLE:
+            return stepper_enable(stepper, true);
+        case MODBUS_COMMAND_DISABLE:
+            return stepper_enable(stepper, false);
+        case MODBUS_COMMAND_STOP:
+            return stepper_stop(stepper);
+        case MODBUS_COMMAND_STOP_DECEL:
+            return stepper_stop_decelerate(stepper);
+        case MODBUS_COMMAND_SET_ZERO:
+            return stepper_set_current_position(stepper, 0);
+        default:
+            return false;
+    }
+}
+
+/*!
+ * @brief Register tables, in increasing address order
+ */
+static const modbus_register_t modbus_input_registers[] =
+{
+    { MODBUS_IR_STATUS,   1, modbus_read_status,   NULL },
+    { MODBUS_IR_POSITION, 2, modbus_read_position, NULL },
+    { MODBUS_IR_TARGET,   2, modbus_read_target,   NULL },
+    { MODBUS_IR_VELOCITY, 2, modbus_read_velocity, NULL },
+};
+
+static const modbus_register_t modbus_holding_registers[] =
+{
+    { MODBUS_HR_STEP_PERIOD,   1, modbus_read_step_period,   modbus_write_step_period },
+    { MODBUS_HR_ACCELERATION,  2, modbus_read_acceleration,  modbus_write_acceleration },
+    { MODBUS_HR_DECELERATION,  2, modbus_read_deceleration,  modbus_write_deceleration },
+    { MODBUS_HR_FEED_OVERRIDE, 1, modbus_read_feed_override, modbus_write_feed_override },
+    { MODBUS_HR_TARGET,        2, modbus_read_target,        modbus_write_target },
+    { MODBUS_HR_COMMAND,       1, modbus_read_zero,          modbus_write_command },
+};
+
+#define MODBUS_INPUT_COUNT                  (int)(sizeof(modbus_input_registers) / sizeof(modbus_input_registers[0]))
+#define MODBUS_HOLDING_COUNT                (int)(sizeof(modbus_holding_registers) / sizeof(modbus_holding_registers[0]))
+
+/* -------------------------- frame helper functions -----------------------------*/
+static uint16_t modbus_crc(const uint8_t* data, int length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for(int i = 0; i < length; i++)
+    {
+        crc = (crc >> 8) ^ modbus_crc_table[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+static uint16_t modbus_get_u16(const uint8_t* data)
+{
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static void modbus_put_u16(uint8_t* data, uint16_t value)
+{
+    data[0] = (uint8_t)(value >> 8);
+    data[1] = (uint8_t)(value & 0xFF);
+}
+
+/*!
+ * @brief Find the register holding an address
+ *
+ * @param table: register table
+ * @param count: number of entries in the table
+ * @param address: register address
+ * @return: pointer to the entry, or NULL if not mapped
+ */
+static const modbus_register_t* modbus_find(const modbus_register_t* table, int count, uint16_t address)
+{
+    for(int i = 0; i < count; i++)
+    {
+        if( address >= table[i].address && address < table[i].address + table[i].words )
+        {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static int modbus_exception(uint8_t* reply, uint8_t function, uint8_t code)
+{
+    reply[1] = function | 0x80;
+    reply[2] = code;
+    modbus_status.exceptions++;
+    return 3;
+}
+
+/*!
+ * @brief Apply the holding register writes of a request
+ *
+ * @param stepper: pointer to the stepper state to apply them to
+ * @param start: first register address
+ * @param count: number of registers
+ * @param data: register values, two bytes each high byte first
+ * @return: true if every write succeeded, false at the first refused value
+ */
+static bool modbus_write_registers(stepper_state_t* stepper, uint16_t start, uint16_t count, const uint8_t* data)
+{
+    for(int i = 0; i < MODBUS_HOLDING_COUNT; i++)
+    {
+        const modbus_register_t* reg = &modbus_holding_registers[i];
+        int32_t value;
+
+        if( reg->address < start || reg->address >= start + count )
+        {
+            continue;
+        }
+
+        value = modbus_get_u16(&data[(reg->address - start) * 2]);
+        if( reg->words == 2 )
+        {
+            value = (int32_t)(((uint32_t)value << 16) | modbus_get_u16(&data[(reg->address - start) * 2 + 2]));
+        }
+        if( !reg->write(stepper, value) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * @brief Handle a read request
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param request: frame without the CRC
+ * @param length: frame length without the CRC
+ * @param reply: buffer for the reply, address already filled in
+ * @return: reply length without the CRC
+ */
+static int modbus_read(stepper_state_t* stepper, const uint8_t* request, int length, uint8_t* reply)
+{
+    const modbus_register_t* table = (request[1] == MODBUS_READ_INPUT) ? modbus_input_registers : modbus_holding_registers;
+    int table_count = (request[1] == MODBUS_READ_INPUT) ? MODBUS_INPUT_COUNT : MODBUS_HOLDING_COUNT;
+    stepper_snapshot_t snapshot;
+    uint16_t start;
+    uint16_t count;
+
+    if( length != 6 )
+    {
+        return modbus_exception(reply, request[1], MODBUS_EXCEPTION_VALUE);
+    }
+    start = modbus_get_u16(&request[2]);
+    count = modbus_get_u16(&request[4]);
+    if( count < 1 || count > MODBUS_MAX_READ )
+    {
+        return modbus_exception(reply, request[1], MODBUS_EXCEPTION_VALUE);
+    }
+    for(uint32_t address = start; address < (uint32_t)start + count; address++)
+    {
+        if( address > 0xFFFF || modbus_find(table, table_count, (uint16_t)address) == NULL )
+        {
+            return modbus_exception(reply, request[1], MODBUS_EXCEPTION_ADDRESS);
+        }
+    }
+
+    // One snapshot for the whole read, so the values are consistent
+    if( !stepper_get_snapshot(stepper, &snapshot) )
+    {
+        return modbus_exception(reply, request[1], MODBUS_EXCEPTION_BUSY);
+    }
+
+    reply[1] = request[1];
+    reply[2] = (uint8_t)(count * 2);
+    for(uint16_t i = 0; i < count; i++)
+    {
+        const modbus_register_t* reg = modbus_find(table, table_count, start + i);
+        uint32_t value = (uint32_t)reg->read(stepper, &snapshot);
+
+        // The high word comes first in a 32 bit pair
+        if( reg->words == 2 && start + i == reg->address )
+        {
+            value >>= 16;
+        }
+        modbus_put_u16(&reply[3 + i * 2], (uint16_t)(value & 0xFFFF));
+    }
+    return 3 + count * 2;
+}
+
+/*!
+ * @brief Handle a write request, single or multiple
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param request: frame without the CRC
+ * @param length: frame length without the CRC
+ * @param reply: buffer for the reply, address already filled in
+ * @return: reply length without the CRC
+ */
+static int modbus_write(stepper_state_t* stepper, const uint8_t* request, int length, uint8_t* reply)
+{
+    const uint8_t* data;
+    uint16_t start;
+    uint16_t count;
+
+    start = modbus_get_u16(&request[2]);
+    if( request[1] == MODBUS_WRITE_SINGLE )
+    {
+        if( length != 6 )
+        {
+            return modbus_exception(reply, request[1], MODBUS_EXCEPTION_VALUE);
+        }
+        count = 1;
+        data = &request[4];
+    }
+    else
+    {
+        count = modbus_get_u16(&request[4]);
+        if( length < 7 || count < 1 || count > MODBUS_MAX_WRITE || request[6] != count * 2 || length != 7 + count * 2 )
+        {
+            return modbus_exception(reply, request[1], MODBUS_EXCEPTION_VALUE);
+        }
+        data = &request[7];
+    }
+
+    // Every register must be writable and 32 bit values written whole
+    for(uint32_t address = start; address < (uint32_t)start + count; address++)
+    {
+        const modbus_register_t* reg = (address > 0xFFFF) ? NULL :
+                                       modbus_find(modbus_holding_registers, MODBUS_HOLDING_COUNT, (uint16_t)address);
+
+        if( reg == NULL || reg->write == NULL || reg->address < start ||
+            (uint32_t)reg->address + reg->words > (uint32_t)start + count )
+        {
+            return modbus_exception(reply, request[1], MODBUS_EXCEPTION_ADDRESS);
+        }
+    }
+
+    // Check the writes on a scratch copy, then apply them all or none
+    if( !modbus_write_registers(stepper_scratch_copy(stepper), start, count, data) )
+    {
+        return modbus_exception(reply, request[1], MODBUS_EXCEPTION_VALUE);
+    }
+    modbus_write_registers(stepper, start, count, data);
+
+    // Single writes echo the request, multiple writes the start and count
+    reply[1] = request[1];
+    modbus_put_u16(&reply[2], start);
+    if( request[1] == MODBUS_WRITE_SINGLE )
+    {
+        reply[4] = request[4];
+        reply[5] = request[5];
+    }
+    else
+    {
+        modbus_put_u16(&reply[4], count);
+    }
+    return 6;
+}
+
+/* -------------------------- modbus functions -----------------------------*/
+bool modbus_init(void)
+{
+    // CRC-16/MODBUS, reflected polynomial 0xA001, one table lookup per byte
+    for(int i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t)i;
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+        modbus_crc_table[i] = crc;
+    }
+
+    uart_init(MODBUS_UART, MODBUS_BAUD);
+    uart_set_format(MODBUS_UART, 8, 1, UART_PARITY_EVEN);
+    gpio_set_function(MODBUS_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(MODBUS_RX_PIN, GPIO_FUNC_UART);
+    return true;
+}
+
+bool modbus_set_address(int address)
+{
+    if( address < 1 || address > MODBUS_MAX_ADDRESS )
+    {
+        return false;
+    }
+    modbus_status.address = address;
+    return true;
+}
+
+void modbus_get_status(modbus_status_t* status)
+{
+    if( status != NULL )
+    {
+        *status = modbus_status;
+    }
+}
+
+bool process_modbus_uart(void)
+{
+    uint32_t now_us = time_us_32();
+    bool moved = false;
+
+    // Bytes arriving before the last frame has been handled are dropped
+    while(uart_is_readable(MODBUS_UART))
+    {
+        uint8_t byte = (uint8_t)uart_getc(MODBUS_UART);
+
+        if( !modbus_frame_ready )
+        {
+            if( modbus_rx_count < MODBUS_FRAME_SIZE )
+            {
+                modbus_rx[modbus_rx_count++] = byte;
+            }
+            else
+            {
+                modbus_rx_overrun = true;
+            }
+        }
+        modbus_rx_last_us = now_us;
+        moved = true;
+    }
+
+    // 3.5 character times of silence end the frame
+    if( modbus_rx_count > 0 && !modbus_frame_ready && (now_us - modbus_rx_last_us) >= MODBUS_T35_US )
+    {
+        modbus_frame_ready = true;
+    }
+
+    while(modbus_tx_index < modbus_tx_count && uart_is_writable(MODBUS_UART))
+    {
+        uart_putc_raw(MODBUS_UART, (char)modbus_tx[modbus_tx_index++]);
+        moved = true;
+    }
+    return moved;
+}
+
+bool process_modbus(stepper_state_t* stepper)
+{
+    int length;
+    int reply_length;
+    uint8_t address;
+
+    // Wait for a frame, and for the last reply to have gone out
+    if( !modbus_frame_ready || modbus_tx_index < modbus_tx_count || stepper == NULL )
+    {
+        return false;
+    }
+
+    length = modbus_rx_count - 2;
+    address = modbus_rx[0];
+    if( modbus_rx_overrun )
+    {
+        modbus_status.overruns++;
+    }
+    else if( length < 2 || modbus_crc(modbus_rx, length) != (modbus_rx[length] | (modbus_rx[length + 1] << 8)) )
+    {
+        modbus_status.crc_errors++;
+    }
+    // Only writes may be broadcast, anything else sent to address 0 is dropped
+    else if( address == modbus_status.address ||
+             (address == 0 && (modbus_rx[1] == MODBUS_WRITE_SINGLE || modbus_rx[1] == MODBUS_WRITE_MULTIPLE)) )
+    {
+        modbus_status.requests++;
+        modbus_tx[0] = address;
+        switch(modbus_rx[1])
+        {
+            case MODBUS_READ_HOLDING:
+            case MODBUS_READ_INPUT:
+                reply_length = modbus_read(stepper, modbus_rx, length, modbus_tx);
+                break;
+            case MODBUS_WRITE_SINGLE:
+            case MODBUS_WRITE_MULTIPLE:
+                reply_length = modbus_write(stepper, modbus_rx, length, modbus_tx);
+                break;
+            default:
+                reply_length = modbus_exception(modbus_tx, modbus_rx[1], MODBUS_EXCEPTION_FUNCTION);
+                break;
+        }
+
+        // Broadcasts are never answered
+        if( address != 0 )
+        {
+            uint16_t crc = modbus_crc(modbus_tx, reply_length);
+            modbus_tx[reply_length] = (uint8_t)(crc & 0xFF);
+            modbus_tx[reply_length + 1] = (uint8_t)(crc >> 8);
+            modbus_tx_count = reply_length + 2;
+            modbus_tx_index = 0;
+            modbus_status.replies++;
+        }
+    }
+
+    modbus_rx_count = 0;
+    modbus_rx_overrun = false;
+    modbus_frame_ready = false;
+    return true;
+}
@@ -0,0 +1,121 @@
+/**
+    * @file modbus.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the Modbus RTU server
+    *
+    * A Modbus RTU server on UART0 serves a fixed table of registers, so a PLC can drive the
+    * claw without the text command interface. Supported functions are 03 read holding
+    * registers, 04 read input registers, 06 write single register and 16 write multiple
+    * registers. 32 bit values take two registers, high word first, and can only be written
+    * together in one function 16 request. Reads come from one stepper snapshot, so a read
+    * of several registers is consistent. All the writes of a request are first checked on
+    * a scratch copy of the stepper state and either all applied or none, a rejected value
+    * gets exception 03. Address 0 is broadcast, writes are applied without a reply and any
+    * other request is dropped.
+    *
+    * The UART is polled every ten microsecond tick, a frame ends after 3.5 character times
+    * of silence, and each received frame is handled on the following millisecond tick.
+*/
+
+#ifndef MODBUS_H
+#define MODBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stepper.h"
+
+#define MODBUS_TX_PIN                       0       // GPIO pin for the UART0 TX output
+#define MODBUS_RX_PIN                       1       // GPIO pin for the UART0 RX input
+#define MODBUS_BAUD                         19200   // Baud rate, 8 data bits, even parity, 1 stop bit
+#define MODBUS_DEFAULT_ADDRESS              1       // Server address at power on
+#define MODBUS_MAX_ADDRESS                  247     // Highest server address
+#define MODBUS_FRAME_SIZE                   256     // Longest RTU frame in bytes
+
+/* ---- Input registers, function 04 ---- */
+#define MODBUS_IR_STATUS                    0       // MODBUS_STATUS bits
+#define MODBUS_IR_POSITION                  1       // Current position in steps, 2 registers
+#define MODBUS_IR_TARGET                    3       // Target position in steps, 2 registers
+#define MODBUS_IR_VELOCITY                  5       // Commanded velocity in steps/s, negative backward, 2 registers
+
+#define MODBUS_STATUS_MOVING                0x0001  // Move in progress
+#define MODBUS_STATUS_ENABLED               0x0002  // Stepper enabled
+#define MODBUS_STATUS_ESTOP                 0x0004  // Estop input active
+#define MODBUS_STATUS_ESTOP_STOPPING        0x0008  // Braking for a category 1 estop
+#define MODBUS_STATUS_GEAR                  0x0010  // Following the external axis
+#define MODBUS_STATUS_TRACK                 0x0020  // Following tracking setpoints
+
+/* ---- Holding registers, functions 03, 06 and 16 ---- */
+#define MODBUS_HR_STEP_PERIOD               0       // Step period in us
+#define MODBUS_HR_ACCELERATION              1       // Acceleration in steps/s^2, 2 registers
+#define MODBUS_HR_DECELERATION              3       // Deceleration in steps/s^2, 2 registers
+#define MODBUS_HR_FEED_OVERRIDE             5       // Feed rate override in percent
+#define MODBUS_HR_TARGET                    6       // Writing starts a move to this position in steps, 2 registers
+#define MODBUS_HR_COMMAND                   8       // Write a MODBUS_COMMAND value, reads as 0
+
+#define MODBUS_COMMAND_ENABLE               1       // Enable the stepper
+#define MODBUS_COMMAND_DISABLE              2       // Disable the stepper
+#define MODBUS_COMMAND_STOP                 3       // Stop instantly
+#define MODBUS_COMMAND_STOP_DECEL           4       // Stop at the deceleration
+#define MODBUS_COMMAND_SET_ZERO             5       // Set the current position to zero
+
+/*!
+ * @brief Modbus server counters
+ */
+typedef struct modbus_status
+{
+    int address;                //!< Server address
+    uint32_t requests;          //!< Frames addressed to this server or broadcast
+    uint32_t replies;           //!< Replies sent, including exceptions
+    uint32_t exceptions;        //!< Exception replies
+    uint32_t crc_errors;        //!< Frames dropped for a bad CRC or length
+    uint32_t overruns;          //!< Frames dropped for being too long
+} modbus_status_t;
+
+/*!
+ * @brief Set up UART0 for the Modbus server
+ *
+ * @param: none
+ * @return: true on success, false on failure
+ */
+bool modbus_init(void);
+
+/*!
+ * @brief Set the server address
+ *
+ * @param address: address from 1 to MODBUS_MAX_ADDRESS
+ * @return: true on success, false on an invalid address
+ */
+bool modbus_set_address(int address);
+
+/*!
+ * @brief Get the server address and counters
+ *
+ * @param status: pointer to the structure to fill
+ * @return: none
+ */
+void modbus_get_status(modbus_status_t* status);
+
+/*!
+ * @brief Move received bytes into the frame and reply bytes out to the UART
+ *
+ * @note: Called every TIMER_INTERVAL_US, only touches the UART FIFOs.
+ *
+ * @param: none
+ * @return: true if any byte was moved, false otherwise
+ */
+bool process_modbus_uart(void);
+
+/*!
+ * @brief Handle a received frame and queue the reply
+ *
+ * @note: Called every millisecond.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if a frame was handled, false otherwise
+ */
+bool process_modbus(stepper_state_t* stepper);
+
+#endif // MODBUS_H
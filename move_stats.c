@@ -0,0 +1,167 @@
+/**
+    * @file move_stats.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of per move execution statistics
+    * 
+    * This file contains the record ring and the per tick update.
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "sys_timer.h"
+#include "move_stats.h"
+
+static move_stats_record_t move_stats_records[MOVE_STATS_RECORDS];
+static int move_stats_head = 0;
+static int move_stats_count = 0;
+static uint32_t move_stats_number = 0;
+static bool move_stats_recording = false;
+static move_stats_record_t move_stats_current;
+static uint32_t move_stats_start_us = 0;
+static int move_stats_last_target = 0;
+static bool move_stats_last_approach = false;
+
+/*!
+ * @brief Duration of the trapezoidal profile from rest to rest
+ *
+ * @note: Uses the fixed acceleration and deceleration, speed zones, the acceleration
+ *        table and backlash are not included.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param distance: steps to travel
+ * @return: duration in microseconds
+ */
+static uint32_t move_stats_ideal_us(const stepper_state_t* stepper, int distance)
+{
+    float speed = 1.0f / (stepper->step_period * STEPPER_TICK_S) * stepper->feed_override / 100.0f;
+    float acceleration = (float)stepper->acceleration;
+    float deceleration = (float)stepper->deceleration;
+    float ramp_distance;
+    float seconds;
+
+    if( speed > STEPPER_MAX_SPEED )
+    {
+        speed = STEPPER_MAX_SPEED;
+    }
+
+    ramp_distance = speed * speed / (2.0f * acceleration) + speed * speed / (2.0f * deceleration);
+    if( distance >= ramp_distance )
+    {
+        seconds = speed / acceleration + speed / deceleration + (distance - ramp_distance) / speed;
+    }
+    else
+    {
+        // Triangular profile, the peak speed is never reached
+        speed = sqrtf(2.0f * distance * acceleration * deceleration / (acceleration + deceleration));
+        seconds = speed / acceleration + speed / deceleration;
+    }
+    return (uint32_t)(seconds * 1e6f);
+}
+
+/* -------------------------- move statistics functions -----------------------------*/
+bool move_stats_is_recording(void)
+{
+    return move_stats_recording;
+}
+
+bool move_stats_get(int age, move_stats_record_t* record)
+{
+    if( record == NULL || age < 0 || age >= move_stats_count )
+    {
+        return false;
+    }
+
+    *record = move_stats_records[(move_stats_head - 1 - age + MOVE_STATS_RECORDS) % MOVE_STATS_RECORDS];
+    return true;
+}
+
+void move_stats_clear(void)
+{
+    move_stats_head = 0;
+    move_stats_count = 0;
+}
+
+bool process_move_stats(const stepper_state_t* stepper, int backlog)
+{
+    move_stats_record_t* record = &move_stats_current;
+    int speed;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Open a record when a move starts from a standstill
+    if( !move_stats_recording )
+    {
+        if( !stepper->moving )
+        {
+            return false;
+        }
+        record->number = ++move_stats_number;
+        record->start_position = stepper->current_position;
+        record->target_position = stepper->target_position;
+        record->ideal_us = move_stats_ideal_us(stepper, abs(stepper->target_position - stepper->current_position));
+        record->peak_speed = 0;
+        record->max_late_us = 0;
+        record->late_ticks = 0;
+        record->flags = 0;
+        move_stats_last_target = stepper->target_position;
+        move_stats_last_approach = stepper->approach_pending;
+        move_stats_start_us = time_us_32();
+        move_stats_recording = true;
+    }
+
+    speed = (int)stepper->velocity;
+    if( speed > record->peak_speed )
+    {
+        record->peak_speed = speed;
+    }
+
+    if( backlog > 0 )
+    {
+        record->late_ticks++;
+        if( (uint32_t)backlog * TIMER_INTERVAL_US > record->max_late_us )
+        {
+            record->max_late_us = (uint32_t)backlog * TIMER_INTERVAL_US;
+        }
+    }
+
+    // An estop brakes by moving the target and de-energises the motor as it stops the move
+    if( stepper->estop_stopping || !stepper->enabled )
+    {
+        record->flags |= MOVE_STATS_ESTOP;
+    }
+    else if( stepper->gear_enabled || stepper->track_enabled )
+    {
+        record->flags |= MOVE_STATS_FOLLOW;
+    }
+    // Turning round for the final approach is part of the move, any other new target is not
+    else if( stepper->target_position != move_stats_last_target &&
+             !(move_stats_last_approach && !stepper->approach_pending && stepper->target_position == stepper->approach_target) )
+    {
+        record->flags |= MOVE_STATS_RETARGET;
+    }
+    move_stats_last_target = stepper->target_position;
+    move_stats_last_approach = stepper->approach_pending;
+
+    if( stepper->moving )
+    {
+        return false;
+    }
+
+    record->end_position = stepper->current_position;
+    record->actual_us = time_us_32() - move_stats_start_us;
+    move_stats_records[move_stats_head] = *record;
+    move_stats_head = (move_stats_head + 1) % MOVE_STATS_RECORDS;
+    if( move_stats_count < MOVE_STATS_RECORDS )
+    {
+        move_stats_count++;
+    }
+    move_stats_recording = false;
+    return true;
+}
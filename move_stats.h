@@ -0,0 +1,81 @@
+/**
+    * @file move_stats.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for per move execution statistics
+    * 
+    * Every move from a standstill to the next standstill leaves a small record of how it
+    * ran: the ideal and achieved duration, the peak speed, how late the 10 us tick ran and
+    * whether an estop or a new target cut it short. The latest records are kept so a slowly
+    * degrading axis or a timing regression shows up move by move.
+*/
+
+#ifndef MOVE_STATS_H
+#define MOVE_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stepper.h"
+
+#define MOVE_STATS_RECORDS                  16      // Number of move records kept
+
+#define MOVE_STATS_RETARGET                 0x01    // The target changed during the move, including a stop
+#define MOVE_STATS_ESTOP                    0x02    // An estop stopped the move
+#define MOVE_STATS_FOLLOW                   0x04    // Geared or tracking, the target moves by design
+
+/*!
+ * @brief Statistics of one move
+ */
+typedef struct move_stats_record
+{
+    uint32_t number;                    //!< Move number since power up, from 1
+    int start_position;                 //!< Position at the start of the move
+    int target_position;                //!< Target at the start of the move
+    int end_position;                   //!< Position at the end of the move
+    uint32_t ideal_us;                  //!< Duration of the ideal trapezoidal profile to the first target
+    uint32_t actual_us;                 //!< Time from the first to the last tick of the move
+    int peak_speed;                     //!< Highest speed in steps/s
+    uint32_t max_late_us;               //!< Longest the 10 us tick ran behind the timer
+    uint32_t late_ticks;                //!< Ticks run with other ticks still waiting
+    uint32_t flags;                     //!< MOVE_STATS flag bits
+} move_stats_record_t;
+
+/*!
+ * @brief Check whether a move is being recorded
+ *
+ * @param: none
+ * @return: true while a move record is open, false otherwise
+ */
+bool move_stats_is_recording(void);
+
+/*!
+ * @brief Get a move record
+ *
+ * @param age: 0 for the latest completed move, 1 for the one before and so on
+ * @param record: pointer to the structure to fill
+ * @return: true on success, false if there is no such record
+ */
+bool move_stats_get(int age, move_stats_record_t* record);
+
+/*!
+ * @brief Discard all move records
+ *
+ * @param: none
+ * @return: none
+ */
+void move_stats_clear(void);
+
+/*!
+ * @brief Update the record of the move in progress
+ *
+ * @note: Called every TIMER_INTERVAL_US after the movement while moving or recording.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param backlog: ticks still waiting to run after this one
+ * @return: true if a move record was completed, false otherwise
+ */
+bool process_move_stats(const stepper_state_t* stepper, int backlog);
+
+#endif // MOVE_STATS_H
@@ -0,0 +1,131 @@
+/**
+    * @file probe.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the touch probe input
+    * 
+    * This file contains the probe edge interrupt handler and the arm, read and stop functions.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "probe.h"
+#include "encoder.h"
+#include "event_log.h"
+
+#define PROBE_EDGE_EVENTS                   (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
+
+static stepper_state_t* probe_stepper = NULL;
+static uint32_t probe_event = GPIO_IRQ_EDGE_FALL;
+static bool probe_stop = false;
+static volatile bool probe_stop_pending = false;
+static volatile probe_capture_t probe_capture = { false, false, 0, 0, 0 };
+
+/* -------------------------- probe interrupt -----------------------------*/
+/* Note: Shares IO_IRQ_BANK0 with any other GPIO interrupts through the SDK   */
+/* raw handler list. The step engine only changes current_position between    */
+/* step pulses in the superloop, so the single word read here is the position */
+/* of the last step issued before the edge.                                   */
+/* ---------------------------------------------------------------------------*/
+static void probe_irq_handler(void)
+{
+    uint32_t events = gpio_get_irq_event_mask(PROBE_PIN) & PROBE_EDGE_EVENTS;
+
+    if( events == 0 )
+    {
+        return;
+    }
+    gpio_acknowledge_irq(PROBE_PIN, events);
+
+    if( !probe_capture.armed || (events & probe_event) == 0 )
+    {
+        return;
+    }
+
+    // One capture per arm, later edges from contact bounce are ignored
+    gpio_set_irq_enabled(PROBE_PIN, PROBE_EDGE_EVENTS, false);
+    probe_capture.position = *(volatile int*)&probe_stepper->current_position;
+    probe_capture.encoder_count = encoder_get_count();
+    probe_capture.time_us = time_us_32();
+    probe_capture.armed = false;
+    probe_capture.triggered = true;
+    probe_stop_pending = probe_stop;
+    EVENT_LOG("Probe triggered at %d, encoder %d", probe_capture.position, (int)probe_capture.encoder_count);
+}
+
+/* -------------------------- probe functions -----------------------------*/
+bool probe_arm(stepper_state_t* stepper, int edge, bool stop)
+{
+    static bool probe_initialized = false;
+
+    if( stepper == NULL || (edge != PROBE_EDGE_FALLING && edge != PROBE_EDGE_RISING) )
+    {
+        return false;
+    }
+
+    if( !probe_initialized )
+    {
+        gpio_init(PROBE_PIN);
+        gpio_set_dir(PROBE_PIN, GPIO_IN);
+        gpio_pull_up(PROBE_PIN);
+        gpio_add_raw_irq_handler(PROBE_PIN, probe_irq_handler);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+        probe_initialized = true;
+    }
+
+    // Disarm while the capture is reset so the handler never sees half the new settings
+    gpio_set_irq_enabled(PROBE_PIN, PROBE_EDGE_EVENTS, false);
+    probe_stepper = stepper;
+    probe_event = (edge == PROBE_EDGE_RISING) ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    probe_stop = stop;
+    probe_stop_pending = false;
+    probe_capture.triggered = false;
+    probe_capture.armed = true;
+
+    // Discard any edge latched while the probe was disarmed
+    gpio_acknowledge_irq(PROBE_PIN, PROBE_EDGE_EVENTS);
+    gpio_set_irq_enabled(PROBE_PIN, probe_event, true);
+    return true;
+}
+
+bool probe_disarm(void)
+{
+    if( !probe_capture.armed )
+    {
+        return false;
+    }
+
+    gpio_set_irq_enabled(PROBE_PIN, PROBE_EDGE_EVENTS, false);
+    probe_capture.armed = false;
+    return true;
+}
+
+bool probe_get_capture(probe_capture_t* capture)
+{
+    if( capture == NULL )
+    {
+        return false;
+    }
+
+    // The handler disarms itself before writing, so a triggered capture no longer changes
+    capture->armed = probe_capture.armed;
+    capture->triggered = probe_capture.triggered;
+    capture->position = probe_capture.position;
+    capture->encoder_count = probe_capture.encoder_count;
+    capture->time_us = probe_capture.time_us;
+    return true;
+}
+
+bool process_probe(stepper_state_t* stepper)
+{
+    if( !probe_stop_pending || stepper == NULL )
+    {
+        return false;
+    }
+
+    probe_stop_pending = false;
+    return stepper_stop_decelerate(stepper);
+}
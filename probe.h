@@ -0,0 +1,74 @@
+/**
+    * @file probe.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the touch probe input
+    * 
+    * An edge on the probe input latches the step position, the external step/dir count and
+    * the time from a GPIO interrupt, so the capture does not wait for the 10 us tick. The
+    * move in progress can optionally be braked to a stop once the probe has triggered.
+*/
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stepper.h"
+
+#define PROBE_PIN                           17      // GPIO pin for the probe input, pulled up
+#define PROBE_EDGE_FALLING                  0       // Trigger when the input goes low, e.g. a contact to ground
+#define PROBE_EDGE_RISING                   1       // Trigger when the input goes high
+
+/*!
+ * @brief Values latched when the probe triggered
+ */
+typedef struct probe_capture
+{
+    bool armed;                         //!< Waiting for the probe edge
+    bool triggered;                     //!< An edge has been captured since the probe was armed
+    int position;                       //!< Step position at the edge
+    int32_t encoder_count;              //!< External step/dir count at the edge
+    uint32_t time_us;                   //!< Time of the edge in microseconds
+} probe_capture_t;
+
+/*!
+ * @brief Arm the probe for a single capture, clearing any previous capture
+ *
+ * @param stepper: pointer to stepper state structure whose position is latched
+ * @param edge: PROBE_EDGE_FALLING or PROBE_EDGE_RISING
+ * @param stop: brake the move in progress to a stop once the probe triggers
+ * @return: true on success, false on invalid parameters
+ */
+bool probe_arm(stepper_state_t* stepper, int edge, bool stop);
+
+/*!
+ * @brief Disarm the probe, keeping any capture already made
+ *
+ * @param: none
+ * @return: true on success, false if the probe was not armed
+ */
+bool probe_disarm(void);
+
+/*!
+ * @brief Get the state of the probe and the latched values
+ *
+ * @param capture: pointer to the structure to fill
+ * @return: true on success, false on invalid parameters
+ */
+bool probe_get_capture(probe_capture_t* capture);
+
+/*!
+ * @brief Stop the move in progress after a probe trigger armed with stop
+ *
+ * @note: Called every 10 us tick, the interrupt only latches the position and
+ * leaves the stepper state to the superloop.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if the move was told to stop, false otherwise
+ */
+bool process_probe(stepper_state_t* stepper);
+
+#endif // PROBE_H
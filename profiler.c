@@ -0,0 +1,172 @@
+/**
+    * @file profiler.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the statistical sampling profiler
+    * 
+    * This file contains the sample interrupt handler, histogram and dump functions.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/irq.h"
+#include "profiler.h"
+
+// Flash image bounds from the SDK linker script
+extern char __flash_binary_start;
+extern char __flash_binary_end;
+
+static int profiler_alarm = -1;
+static volatile bool profiler_running = false;
+static volatile uint32_t profiler_histogram[PROFILER_BUCKETS];
+static volatile uint32_t profiler_samples = 0;
+static volatile uint32_t profiler_other_samples = 0;
+static uint32_t profiler_base = 0;
+static uint32_t profiler_limit = 0;
+static uint32_t profiler_bucket_shift = PROFILER_MIN_BUCKET_SHIFT;
+static uint16_t profiler_lfsr = 0xACE1;
+
+/* -------------------------- profiler interrupt -----------------------------*/
+/* Note: The handler is installed directly in the vector table, so on entry LR */
+/* holds EXC_RETURN and the interrupted PC is in the hardware stacked frame.   */
+/* The naked entry picks the stack in use and passes the frame to C.           */
+/* ---------------------------------------------------------------------------*/
+void __attribute__((used)) profiler_sample(uint32_t* frame)
+{
+    uint32_t pc = frame[6];
+    uint32_t alarm_bit = 1u << profiler_alarm;
+
+    // Acknowledge and re-arm the alarm with a little jitter to avoid aliasing
+    timer_hw->intr = alarm_bit;
+    profiler_lfsr = (profiler_lfsr >> 1) ^ (-(profiler_lfsr & 1u) & 0xB400u);
+    timer_hw->alarm[profiler_alarm] = timer_hw->timerawl + PROFILER_SAMPLE_PERIOD_US + (profiler_lfsr & PROFILER_SAMPLE_JITTER_MASK);
+
+    profiler_samples++;
+    if(pc >= profiler_base && pc < profiler_limit)
+    {
+        profiler_histogram[(pc - profiler_base) >> profiler_bucket_shift]++;
+    }
+    else
+    {
+        // Code running from RAM or ROM
+        profiler_other_samples++;
+    }
+}
+
+static void __attribute__((naked)) profiler_irq_handler(void)
+{
+    __asm volatile(
+        "tst lr, #4         \n"
+        "ite eq             \n"
+        "mrseq r0, msp      \n"
+        "mrsne r0, psp      \n"
+        "b profiler_sample  \n"
+    );
+}
+
+/* -------------------------- profiler control functions -----------------------------*/
+bool profiler_start(void)
+{
+    uint32_t size;
+
+    if(profiler_alarm < 0)
+    {
+        profiler_alarm = hardware_alarm_claim_unused(false);
+        if(profiler_alarm < 0)
+        {
+            return false;
+        }
+        uint irq = hardware_alarm_get_irq_num(profiler_alarm);
+        irq_set_exclusive_handler(irq, profiler_irq_handler);
+        // Highest priority so the timer callback itself is sampled
+        irq_set_priority(irq, PICO_HIGHEST_IRQ_PRIORITY);
+        irq_set_enabled(irq, true);
+    }
+
+    profiler_stop();
+
+    // Size the buckets so the whole flash image fits in the histogram
+    profiler_base = (uint32_t)&__flash_binary_start;
+    profiler_limit = (uint32_t)&__flash_binary_end;
+    size = profiler_limit - profiler_base;
+    profiler_bucket_shift = PROFILER_MIN_BUCKET_SHIFT;
+    while((size >> profiler_bucket_shift) >= PROFILER_BUCKETS)
+    {
+        profiler_bucket_shift++;
+    }
+
+    for(int i = 0; i < PROFILER_BUCKETS; i++)
+    {
+        profiler_histogram[i] = 0;
+    }
+    profiler_samples = 0;
+    profiler_other_samples = 0;
+
+    profiler_running = true;
+    hw_set_bits(&timer_hw->inte, 1u << profiler_alarm);
+    timer_hw->alarm[profiler_alarm] = timer_hw->timerawl + PROFILER_SAMPLE_PERIOD_US;
+    return true;
+}
+
+bool profiler_stop(void)
+{
+    if(!profiler_running)
+    {
+        return false;
+    }
+
+    hw_clear_bits(&timer_hw->inte, 1u << profiler_alarm);
+    timer_hw->armed = 1u << profiler_alarm;
+    timer_hw->intr = 1u << profiler_alarm;
+    profiler_running = false;
+    return true;
+}
+
+bool profiler_dump(void)
+{
+    static bool printed[PROFILER_BUCKETS];
+    uint32_t samples = profiler_samples;
+
+    if(samples == 0)
+    {
+        return false;
+    }
+
+    printf("Profile: %lu samples, %lu outside flash, %lu byte buckets%s\n", (unsigned long)samples,
+           (unsigned long)profiler_other_samples, (unsigned long)(1u << profiler_bucket_shift),
+           profiler_running ? " (running)" : "");
+    printf("  %-23s %10s %8s\n", "Address range", "Samples", "Percent");
+
+    for(int i = 0; i < PROFILER_BUCKETS; i++)
+    {
+        printed[i] = false;
+    }
+
+    // Repeated selection of the hottest remaining bucket, only run on demand
+    for(int entry = 0; entry < PROFILER_DUMP_ENTRIES; entry++)
+    {
+        int hottest = -1;
+        for(int i = 0; i < PROFILER_BUCKETS; i++)
+        {
+            if(!printed[i] && profiler_histogram[i] > 0 && (hottest < 0 || profiler_histogram[i] > profiler_histogram[hottest]))
+            {
+                hottest = i;
+            }
+        }
+        if(hottest < 0)
+        {
+            break;
+        }
+        printed[hottest] = true;
+
+        uint32_t start = profiler_base + ((uint32_t)hottest << profiler_bucket_shift);
+        uint32_t count = profiler_histogram[hottest];
+        printf("  0x%08lx-0x%08lx %10lu %7.2f%%\n", (unsigned long)start,
+               (unsigned long)(start + (1u << profiler_bucket_shift) - 1), (unsigned long)count,
+               100.0 * count / samples);
+    }
+    return true;
+}
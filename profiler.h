@@ -0,0 +1,47 @@
+/**
+    * @file profiler.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the statistical sampling profiler
+    * 
+    * A spare hardware alarm interrupts the processor at a jittered period and records the
+    * interrupted program counter into a histogram of flash address ranges. The hottest ranges
+    * are printed for symbolisation on the host, e.g. with arm-none-eabi-addr2line.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#define PROFILER_SAMPLE_PERIOD_US           97      // Base sample period in microseconds, prime so it does not lock to the 10 us tick
+#define PROFILER_SAMPLE_JITTER_MASK         0x0F    // Random jitter added to each period in microseconds (0 to 15 us)
+#define PROFILER_BUCKETS                    1024    // Number of histogram buckets spread over the flash image
+#define PROFILER_MIN_BUCKET_SHIFT           2       // Smallest bucket is 4 bytes (2 Thumb instructions)
+#define PROFILER_DUMP_ENTRIES               16      // Number of hottest buckets printed by profiler_dump()
+
+/*!
+ * @brief Start sampling, clearing any previous histogram
+ *
+ * @param: none
+ * @return: true on success, false if no hardware alarm is available
+ */
+bool profiler_start(void);
+
+/*!
+ * @brief Stop sampling, the histogram is kept for profiler_dump()
+ *
+ * @param: none
+ * @return: true on success, false if the profiler was not running
+ */
+bool profiler_stop(void);
+
+/*!
+ * @brief Print the hottest address ranges in the histogram
+ *
+ * @param: none
+ * @return: true on success, false if there are no samples
+ */
+bool profiler_dump(void);
+
+#endif // PROFILER_H
@@ -0,0 +1,82 @@
+/**
+    * @file session.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of command session recording
+    * 
+    * This file contains the session buffer and the record and dump functions.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "session.h"
+
+static char session_buffer[SESSION_BUFFER_SIZE];
+static int session_length = 0;
+static int session_commands = 0;
+static bool session_recording = false;
+static bool session_overflow = false;
+static uint64_t session_start_us = 0;
+
+/* -------------------------- session recording functions -----------------------------*/
+void session_record_start(void)
+{
+    session_length = 0;
+    session_commands = 0;
+    session_overflow = false;
+    session_start_us = time_us_64();
+    session_recording = true;
+}
+
+bool session_record_stop(void)
+{
+    if(!session_recording)
+    {
+        return false;
+    }
+
+    session_recording = false;
+    return true;
+}
+
+void session_record(const char* cmd)
+{
+    int space = SESSION_BUFFER_SIZE - session_length;
+    int written;
+
+    if(!session_recording)
+    {
+        return;
+    }
+
+    written = snprintf(&session_buffer[session_length], space, "%lu %s\n",
+                       (unsigned long)((time_us_64() - session_start_us) / 1000), cmd);
+
+    // Drop the partial line and stop if the buffer is full
+    if(written < 0 || written >= space)
+    {
+        session_buffer[session_length] = '\0';
+        session_overflow = true;
+        session_recording = false;
+        return;
+    }
+
+    session_length += written;
+    session_commands++;
+}
+
+bool session_dump(void)
+{
+    if(session_commands == 0)
+    {
+        return false;
+    }
+
+    printf("# claw session: %d commands%s%s\n", session_commands,
+           session_overflow ? ", truncated" : "", session_recording ? ", recording" : "");
+    fwrite(session_buffer, 1, session_length, stdout);
+    printf("# end of session\n");
+    return true;
+}
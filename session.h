@@ -0,0 +1,53 @@
+/**
+    * @file session.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for recording command sessions
+    * 
+    * Received commands are stored with a millisecond timestamp relative to the start of
+    * recording. The dump is one "<ms> <command>" line per command, which the host replay
+    * tool in sim/ feeds back into the simulated firmware.
+*/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#define SESSION_BUFFER_SIZE                 16384   // Bytes of recorded "<ms> <command>" lines
+
+/*!
+ * @brief Start recording, discarding any previous session
+ *
+ * @param: none
+ * @return: none
+ */
+void session_record_start(void);
+
+/*!
+ * @brief Stop recording, the session is kept for session_dump()
+ *
+ * @param: none
+ * @return: true on success, false if not recording
+ */
+bool session_record_stop(void);
+
+/*!
+ * @brief Record a received command if recording is active
+ *
+ * @note: Recording stops when the buffer is full.
+ *
+ * @param cmd: pointer to command string
+ * @return: none
+ */
+void session_record(const char* cmd);
+
+/*!
+ * @brief Print the recorded session
+ *
+ * @param: none
+ * @return: true on success, false if nothing has been recorded
+ */
+bool session_dump(void);
+
+#endif // SESSION_H
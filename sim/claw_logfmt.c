@@ -0,0 +1,287 @@
+/**
+    * @file claw_logfmt.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host formatter for the deferred format event log
+    * 
+    * Reads a "log dump" from the firmware and formats each record with the format string
+    * found in the ELF file of the same build, e.g. build/claw.elf or build_sim/claw_sim:
+    *
+    *   claw_logfmt <elf> [dump.txt]
+    *
+    * The dump is read from stdin when no file is given. A format id is the offset of the
+    * format string from the event_log_format_base symbol, which works for the fixed
+    * addresses of the device image and the position independent simulator alike. 32 and
+    * 64 bit little endian ELF files are supported.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define LOGFMT_LINE_LENGTH                  256     // Longest dump line
+#define LOGFMT_MAX_ARGS                     4       // Matches EVENT_LOG_MAX_ARGS in event_log.h
+#define LOGFMT_BASE_SYMBOL                  "event_log_format_base"
+
+#define ELF_SHT_SYMTAB                      2
+#define ELF_SHT_NOBITS                      8
+#define ELF_SHF_ALLOC                       0x2
+
+/*!
+ * @brief Section header fields used by the formatter, for either ELF class
+ */
+typedef struct logfmt_section
+{
+    uint32_t type;          //!< Section type
+    uint64_t flags;         //!< Section flags
+    uint64_t address;       //!< Virtual address
+    uint64_t offset;        //!< Offset in the file
+    uint64_t size;          //!< Size in bytes
+    uint32_t link;          //!< Linked section, the string table of a symbol table
+    uint64_t entry_size;    //!< Size of each entry of a table
+} logfmt_section_t;
+
+static uint8_t* logfmt_elf = NULL;
+static size_t logfmt_elf_size = 0;
+static bool logfmt_elf64 = false;
+
+/* -------------------------- ELF helper functions -----------------------------*/
+static uint64_t logfmt_read(uint64_t offset, int bytes)
+{
+    uint64_t value = 0;
+
+    if(offset + bytes > logfmt_elf_size)
+    {
+        return 0;
+    }
+    for(int i = bytes - 1; i >= 0; i--)
+    {
+        value = (value << 8) | logfmt_elf[offset + i];
+    }
+    return value;
+}
+
+static bool logfmt_load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    long size;
+
+    if(file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    logfmt_elf = malloc(size > 0 ? size : 1);
+    if(logfmt_elf == NULL || size < 64 || fread(logfmt_elf, 1, size, file) != (size_t)size)
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    logfmt_elf_size = (size_t)size;
+
+    if(memcmp(logfmt_elf, "\177ELF", 4) != 0 || logfmt_elf[5] != 1)
+    {
+        fprintf(stderr, "%s: not a little endian ELF file\n", path);
+        return false;
+    }
+    logfmt_elf64 = (logfmt_elf[4] == 2);
+    return true;
+}
+
+static int logfmt_section_count(void)
+{
+    return (int)logfmt_read(logfmt_elf64 ? 0x3C : 0x30, 2);
+}
+
+static logfmt_section_t logfmt_section(int index)
+{
+    logfmt_section_t section;
+    uint64_t header;
+
+    if(logfmt_elf64)
+    {
+        header = logfmt_read(0x28, 8) + (uint64_t)index * logfmt_read(0x3A, 2);
+        section.type = (uint32_t)logfmt_read(header + 0x04, 4);
+        section.flags = logfmt_read(header + 0x08, 8);
+        section.address = logfmt_read(header + 0x10, 8);
+        section.offset = logfmt_read(header + 0x18, 8);
+        section.size = logfmt_read(header + 0x20, 8);
+        section.link = (uint32_t)logfmt_read(header + 0x28, 4);
+        section.entry_size = logfmt_read(header + 0x38, 8);
+    }
+    else
+    {
+        header = logfmt_read(0x20, 4) + (uint64_t)index * logfmt_read(0x2E, 2);
+        section.type = (uint32_t)logfmt_read(header + 0x04, 4);
+        section.flags = logfmt_read(header + 0x08, 4);
+        section.address = logfmt_read(header + 0x0C, 4);
+        section.offset = logfmt_read(header + 0x10, 4);
+        section.size = logfmt_read(header + 0x14, 4);
+        section.link = (uint32_t)logfmt_read(header + 0x18, 4);
+        section.entry_size = logfmt_read(header + 0x24, 4);
+    }
+    return section;
+}
+
+static bool logfmt_find_symbol(const char* name, uint64_t* address)
+{
+    for(int i = 0; i < logfmt_section_count(); i++)
+    {
+        logfmt_section_t symtab = logfmt_section(i);
+        logfmt_section_t strtab;
+
+        if(symtab.type != ELF_SHT_SYMTAB || symtab.entry_size == 0)
+        {
+            continue;
+        }
+        strtab = logfmt_section(symtab.link);
+
+        for(uint64_t entry = 0; entry < symtab.size / symtab.entry_size; entry++)
+        {
+            uint64_t symbol = symtab.offset + entry * symtab.entry_size;
+            uint64_t name_offset = strtab.offset + logfmt_read(symbol, 4);
+
+            if(name_offset < logfmt_elf_size && strncmp((const char*)&logfmt_elf[name_offset], name,
+                                                        logfmt_elf_size - name_offset) == 0)
+            {
+                *address = logfmt_read(symbol + (logfmt_elf64 ? 0x08 : 0x04), logfmt_elf64 ? 8 : 4);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static const char* logfmt_string_at(uint64_t address)
+{
+    for(int i = 0; i < logfmt_section_count(); i++)
+    {
+        logfmt_section_t section = logfmt_section(i);
+
+        if((section.flags & ELF_SHF_ALLOC) == 0 || section.type == ELF_SHT_NOBITS)
+        {
+            continue;
+        }
+        if(address >= section.address && address < section.address + section.size &&
+           section.offset + (address - section.address) < logfmt_elf_size)
+        {
+            const char* text = (const char*)&logfmt_elf[section.offset + (address - section.address)];
+            // The string must end inside the file
+            if(memchr(text, '\0', logfmt_elf_size - (section.offset + (address - section.address))) != NULL)
+            {
+                return text;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * @brief Check that a format only takes 32 bit integer arguments
+ *
+ * @param format: pointer to format string
+ * @return: true if safe to format with integer arguments, false otherwise
+ */
+static bool logfmt_format_is_safe(const char* format)
+{
+    for(const char* c = format; *c != '\0'; c++)
+    {
+        if(*c != '%')
+        {
+            continue;
+        }
+        c += strspn(c + 1, "-+ #0123456789.") + 1;
+        if(*c == '\0' || strchr("diuxXc%", *c) == NULL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* -------------------------- main -----------------------------*/
+int main(int argc, char** argv)
+{
+    char line[LOGFMT_LINE_LENGTH];
+    FILE* input = stdin;
+    uint64_t base;
+    int records = 0;
+
+    if(argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "usage: %s <elf> [dump.txt]\n", argv[0]);
+        return 1;
+    }
+
+    if(!logfmt_load(argv[1]))
+    {
+        return 1;
+    }
+
+    if(!logfmt_find_symbol(LOGFMT_BASE_SYMBOL, &base))
+    {
+        fprintf(stderr, "%s: no %s symbol, is the file stripped?\n", argv[1], LOGFMT_BASE_SYMBOL);
+        return 1;
+    }
+
+    if(argc == 3)
+    {
+        input = fopen(argv[2], "r");
+        if(input == NULL)
+        {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    while(fgets(line, sizeof(line), input) != NULL)
+    {
+        unsigned int args[LOGFMT_MAX_ARGS] = { 0, 0, 0, 0 };
+        unsigned long id;
+        unsigned long time_us;
+        const char* format;
+        int count = 0;
+        int used;
+        char* next;
+
+        // Everything but record lines, e.g. the header, prompts and echo, is skipped
+        if(sscanf(line, "%8lx %8lx%n", &id, &time_us, &used) != 2 || used != 17)
+        {
+            continue;
+        }
+        next = line + used;
+        while(count < LOGFMT_MAX_ARGS && sscanf(next, " %8x%n", &args[count], &used) == 1)
+        {
+            next += used;
+            count++;
+        }
+
+        format = logfmt_string_at(base + (int64_t)(int32_t)(uint32_t)id);
+        if(format == NULL || !logfmt_format_is_safe(format))
+        {
+            printf("%10lu <unknown format %08lx>\n", time_us, id);
+            continue;
+        }
+        printf("%10lu ", time_us);
+        printf(format, args[0], args[1], args[2], args[3]);
+        printf("\n");
+        records++;
+    }
+
+    if(input != stdin)
+    {
+        fclose(input);
+    }
+    fprintf(stderr, "%d records formatted\n", records);
+    return 0;
+}
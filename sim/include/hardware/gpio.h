@@ -0,0 +1,31 @@
+/**
+    * @file gpio.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK hardware/gpio.h
+*/
+
+#ifndef SIM_HARDWARE_GPIO_H
+#define SIM_HARDWARE_GPIO_H
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+#define GPIO_IRQ_EDGE_FALL                  0x4u
+#define GPIO_IRQ_EDGE_RISE                  0x8u
+
+typedef enum gpio_function
+{
+    GPIO_FUNC_UART = 2
+} gpio_function_t;
+
+void gpio_set_function(uint gpio, gpio_function_t fn);
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+
+#endif // SIM_HARDWARE_GPIO_H
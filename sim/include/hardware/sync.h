@@ -0,0 +1,29 @@
+/**
+    * @file sync.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK hardware/sync.h
+*/
+
+#ifndef SIM_HARDWARE_SYNC_H
+#define SIM_HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+#define __dmb()                             __sync_synchronize()
+#define __compiler_memory_barrier()         __asm__ volatile ("" ::: "memory")
+
+// The simulator has no interrupts to mask, handlers run between ticks
+static inline uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
+
+#endif // SIM_HARDWARE_SYNC_H
@@ -0,0 +1,15 @@
+/**
+    * @file timer.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK hardware/timer.h
+*/
+
+#ifndef SIM_HARDWARE_TIMER_H
+#define SIM_HARDWARE_TIMER_H
+
+#include "pico/stdlib.h"
+
+#endif // SIM_HARDWARE_TIMER_H
@@ -0,0 +1,38 @@
+/**
+    * @file uart.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK hardware/uart.h
+*/
+
+#ifndef SIM_HARDWARE_UART_H
+#define SIM_HARDWARE_UART_H
+
+#include "pico/stdlib.h"
+
+typedef struct uart_inst
+{
+    int index;              //!< UART number
+} uart_inst_t;
+
+extern uart_inst_t sim_uart0;
+
+#define uart0                               (&sim_uart0)
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+uint uart_init(uart_inst_t* uart, uint baudrate);
+void uart_set_format(uart_inst_t* uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+bool uart_is_readable(uart_inst_t* uart);
+bool uart_is_writable(uart_inst_t* uart);
+char uart_getc(uart_inst_t* uart);
+void uart_putc_raw(uart_inst_t* uart, char c);
+
+#endif // SIM_HARDWARE_UART_H
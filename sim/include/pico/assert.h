@@ -0,0 +1,18 @@
+/**
+    * @file assert.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK pico/assert.h
+*/
+
+#ifndef SIM_PICO_ASSERT_H
+#define SIM_PICO_ASSERT_H
+
+#include "pico/stdlib.h"
+#include <assert.h>
+
+#define hard_assert(x)                      assert(x)
+
+#endif // SIM_PICO_ASSERT_H
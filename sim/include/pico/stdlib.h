@@ -0,0 +1,55 @@
+/**
+    * @file stdlib.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator stand-in for the Pico SDK pico/stdlib.h
+    * 
+    * Declares the subset of the SDK used by the firmware sources built into the simulator.
+    * The implementations in sim_hal.c run against a virtual clock and virtual GPIO.
+*/
+
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+#define PICO_OK                             0
+#define PICO_ERROR_TIMEOUT                  (-1)
+#define PICO_DEFAULT_LED_PIN                25
+
+#define GPIO_OUT                            1
+#define GPIO_IN                             0
+
+#define __not_in_flash_func(func_name)      func_name
+#define __time_critical_func(func_name)     func_name
+
+struct repeating_timer
+{
+    int64_t delay_us;   //!< Repeat interval in microseconds
+};
+
+typedef bool (*repeating_timer_callback_t)(struct repeating_timer *rt);
+
+int getchar_timeout_us(uint32_t timeout_us);
+void stdio_init_all(void);
+bool stdio_usb_connected(void);
+void sleep_ms(uint32_t ms);
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+
+#endif // SIM_PICO_STDLIB_H
@@ -0,0 +1,400 @@
+/**
+    * @file sim_hal.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the simulated hardware
+    * 
+    * This file contains the host versions of the Pico SDK functions used by the firmware.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "sim_hal.h"
+
+static uint64_t sim_time_us = 0;
+
+static bool sim_gpio_output[SIM_GPIO_COUNT];
+static bool sim_gpio_input[SIM_GPIO_COUNT];
+static bool sim_gpio_is_output[SIM_GPIO_COUNT];
+static sim_gpio_hook_t sim_gpio_hook = NULL;
+static uint32_t sim_gpio_irq_enabled[SIM_GPIO_COUNT];
+static uint32_t sim_gpio_irq_events[SIM_GPIO_COUNT];
+static irq_handler_t sim_gpio_irq_handler[SIM_GPIO_COUNT];
+static bool sim_bank0_irq_enabled = false;
+
+static char sim_input_buffer[SIM_INPUT_BUFFER_SIZE];
+static int sim_input_head = 0;
+static int sim_input_tail = 0;
+
+uart_inst_t sim_uart0 = { 0 };
+static uint32_t sim_uart_char_us = 1000;
+static uint8_t sim_uart_rx[SIM_UART_BUFFER_SIZE];
+static uint64_t sim_uart_rx_due_us[SIM_UART_BUFFER_SIZE];
+static int sim_uart_rx_head = 0;
+static int sim_uart_rx_tail = 0;
+static uint8_t sim_uart_tx[SIM_UART_BUFFER_SIZE];
+static int sim_uart_tx_count = 0;
+static uint64_t sim_uart_tx_done_us = 0;
+static bool sim_uart_used = false;
+
+/* -------------------------- simulator control functions -----------------------------*/
+void sim_advance_us(uint32_t us)
+{
+    sim_time_us += us;
+}
+
+bool sim_input_push(const char* line)
+{
+    int length = 0;
+    while(line[length] != '\0')
+    {
+        length++;
+    }
+
+    if(length + 1 > SIM_INPUT_BUFFER_SIZE - 1 - sim_input_pending())
+    {
+        return false;
+    }
+
+    for(int i = 0; i <= length; i++)
+    {
+        sim_input_buffer[sim_input_head] = (i < length) ? line[i] : '\n';
+        sim_input_head = (sim_input_head + 1) % SIM_INPUT_BUFFER_SIZE;
+    }
+    return true;
+}
+
+int sim_input_pending(void)
+{
+    return (sim_input_head - sim_input_tail + SIM_INPUT_BUFFER_SIZE) % SIM_INPUT_BUFFER_SIZE;
+}
+
+void sim_gpio_set_input(unsigned gpio, bool level)
+{
+    uint32_t event;
+
+    if(gpio >= SIM_GPIO_COUNT || sim_gpio_input[gpio] == level)
+    {
+        return;
+    }
+    sim_gpio_input[gpio] = level;
+
+    // Edges are latched even when disabled, like the raw interrupt status register
+    event = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    sim_gpio_irq_events[gpio] |= event;
+
+    // The interrupt runs between ticks, as if it preempted the superloop
+    if(sim_bank0_irq_enabled && (sim_gpio_irq_enabled[gpio] & event) != 0 && sim_gpio_irq_handler[gpio] != NULL)
+    {
+        sim_gpio_irq_handler[gpio]();
+    }
+}
+
+bool sim_gpio_level(unsigned gpio)
+{
+    return (gpio < SIM_GPIO_COUNT) ? sim_gpio_output[gpio] : false;
+}
+
+void sim_set_gpio_hook(sim_gpio_hook_t hook)
+{
+    sim_gpio_hook = hook;
+}
+
+bool sim_uart_push(const uint8_t* data, int length)
+{
+    int pending = (sim_uart_rx_head - sim_uart_rx_tail + SIM_UART_BUFFER_SIZE) % SIM_UART_BUFFER_SIZE;
+    uint64_t due_us = sim_time_us;
+
+    if(length > SIM_UART_BUFFER_SIZE - 1 - pending)
+    {
+        return false;
+    }
+
+    // Back to back after anything still arriving
+    if(pending > 0)
+    {
+        int last = (sim_uart_rx_head + SIM_UART_BUFFER_SIZE - 1) % SIM_UART_BUFFER_SIZE;
+        if(sim_uart_rx_due_us[last] > due_us)
+        {
+            due_us = sim_uart_rx_due_us[last];
+        }
+    }
+
+    sim_uart_used = true;
+    for(int i = 0; i < length; i++)
+    {
+        due_us += sim_uart_char_us;
+        sim_uart_rx[sim_uart_rx_head] = data[i];
+        sim_uart_rx_due_us[sim_uart_rx_head] = due_us;
+        sim_uart_rx_head = (sim_uart_rx_head + 1) % SIM_UART_BUFFER_SIZE;
+    }
+    return true;
+}
+
+int sim_uart_take_reply(uint8_t* data, int size)
+{
+    int count = sim_uart_tx_count;
+
+    if(count == 0 || sim_time_us < sim_uart_tx_done_us + SIM_UART_REPLY_IDLE_US)
+    {
+        return 0;
+    }
+
+    if(count > size)
+    {
+        count = size;
+    }
+    for(int i = 0; i < count; i++)
+    {
+        data[i] = sim_uart_tx[i];
+    }
+    sim_uart_tx_count = 0;
+    return count;
+}
+
+bool sim_uart_busy(void)
+{
+    uint64_t last_us = sim_uart_tx_done_us;
+
+    if(!sim_uart_used)
+    {
+        return false;
+    }
+    if(sim_uart_rx_head != sim_uart_rx_tail)
+    {
+        return true;
+    }
+    if(sim_uart_rx_due_us[(sim_uart_rx_head + SIM_UART_BUFFER_SIZE - 1) % SIM_UART_BUFFER_SIZE] > last_us)
+    {
+        last_us = sim_uart_rx_due_us[(sim_uart_rx_head + SIM_UART_BUFFER_SIZE - 1) % SIM_UART_BUFFER_SIZE];
+    }
+    return sim_uart_tx_count > 0 || sim_time_us < last_us + SIM_UART_REPLY_IDLE_US;
+}
+
+/* -------------------------- SDK stdio and time functions -----------------------------*/
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    int character;
+
+    (void)timeout_us;
+
+    if(sim_input_tail == sim_input_head)
+    {
+        return PICO_ERROR_TIMEOUT;
+    }
+
+    character = (unsigned char)sim_input_buffer[sim_input_tail];
+    sim_input_tail = (sim_input_tail + 1) % SIM_INPUT_BUFFER_SIZE;
+    return character;
+}
+
+void stdio_init_all(void)
+{
+}
+
+bool stdio_usb_connected(void)
+{
+    return true;
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sim_time_us += (uint64_t)ms * 1000;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)sim_time_us;
+}
+
+uint64_t time_us_64(void)
+{
+    return sim_time_us;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, struct repeating_timer *out)
+{
+    (void)callback;
+    (void)user_data;
+
+    // The simulator calls timer_callback() itself as it advances the clock
+    if(out != NULL)
+    {
+        out->delay_us = delay_us;
+    }
+    return true;
+}
+
+/* -------------------------- SDK GPIO functions -----------------------------*/
+void gpio_init(uint gpio)
+{
+    if(gpio < SIM_GPIO_COUNT)
+    {
+        sim_gpio_is_output[gpio] = false;
+        sim_gpio_output[gpio] = false;
+    }
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    if(gpio < SIM_GPIO_COUNT)
+    {
+        sim_gpio_is_output[gpio] = out;
+    }
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if(gpio >= SIM_GPIO_COUNT)
+    {
+        return;
+    }
+
+    if(sim_gpio_output[gpio] != value)
+    {
+        sim_gpio_output[gpio] = value;
+        if(sim_gpio_hook != NULL)
+        {
+            sim_gpio_hook(gpio, value, sim_time_us);
+        }
+    }
+}
+
+bool gpio_get(uint gpio)
+{
+    if(gpio >= SIM_GPIO_COUNT)
+    {
+        return false;
+    }
+    return sim_gpio_is_output[gpio] ? sim_gpio_output[gpio] : sim_gpio_input[gpio];
+}
+
+void gpio_pull_up(uint gpio)
+{
+    sim_gpio_set_input(gpio, true);
+}
+
+void gpio_pull_down(uint gpio)
+{
+    sim_gpio_set_input(gpio, false);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+    if(gpio >= SIM_GPIO_COUNT)
+    {
+        return;
+    }
+
+    if(enabled)
+    {
+        sim_gpio_irq_enabled[gpio] |= event_mask;
+    }
+    else
+    {
+        sim_gpio_irq_enabled[gpio] &= ~event_mask;
+    }
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler)
+{
+    if(gpio < SIM_GPIO_COUNT)
+    {
+        sim_gpio_irq_handler[gpio] = handler;
+    }
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio)
+{
+    return (gpio < SIM_GPIO_COUNT) ? (sim_gpio_irq_events[gpio] & sim_gpio_irq_enabled[gpio]) : 0;
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask)
+{
+    if(gpio < SIM_GPIO_COUNT)
+    {
+        sim_gpio_irq_events[gpio] &= ~event_mask;
+    }
+}
+
+/* -------------------------- SDK interrupt functions -----------------------------*/
+void irq_set_enabled(uint num, bool enabled)
+{
+    if(num == IO_IRQ_BANK0)
+    {
+        sim_bank0_irq_enabled = enabled;
+    }
+}
+
+/* -------------------------- SDK UART functions -----------------------------*/
+uint uart_init(uart_inst_t* uart, uint baudrate)
+{
+    (void)uart;
+
+    // Start, 8 data, parity and stop bits, rounded up
+    sim_uart_char_us = (11000000 + baudrate - 1) / baudrate;
+    return baudrate;
+}
+
+void uart_set_format(uart_inst_t* uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+    (void)uart;
+    (void)data_bits;
+    (void)stop_bits;
+    (void)parity;
+}
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    (void)uart;
+
+    return sim_uart_rx_tail != sim_uart_rx_head && sim_uart_rx_due_us[sim_uart_rx_tail] <= sim_time_us;
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char character = 0;
+
+    (void)uart;
+
+    if(sim_uart_rx_tail != sim_uart_rx_head)
+    {
+        character = (char)sim_uart_rx[sim_uart_rx_tail];
+        sim_uart_rx_tail = (sim_uart_rx_tail + 1) % SIM_UART_BUFFER_SIZE;
+    }
+    return character;
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void)uart;
+
+    // The FIFO drains one character time per byte
+    return sim_uart_tx_done_us < sim_time_us + (uint64_t)SIM_UART_FIFO_SIZE * sim_uart_char_us;
+}
+
+void uart_putc_raw(uart_inst_t* uart, char c)
+{
+    (void)uart;
+
+    if(sim_uart_tx_done_us < sim_time_us)
+    {
+        sim_uart_tx_done_us = sim_time_us;
+    }
+    sim_uart_tx_done_us += sim_uart_char_us;
+    sim_uart_used = true;
+    if(sim_uart_tx_count < SIM_UART_BUFFER_SIZE)
+    {
+        sim_uart_tx[sim_uart_tx_count++] = (uint8_t)c;
+    }
+}
+
+void gpio_set_function(uint gpio, gpio_function_t fn)
+{
+    (void)gpio;
+    (void)fn;
+}
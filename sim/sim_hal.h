@@ -0,0 +1,117 @@
+/**
+    * @file sim_hal.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the simulated hardware
+    * 
+    * The simulator replaces the Pico SDK with a virtual microsecond clock, virtual GPIO
+    * pins and a console input queue. Time only moves when the simulator advances it.
+*/
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_GPIO_COUNT                      48      // Number of simulated GPIO pins
+#define SIM_INPUT_BUFFER_SIZE               4096    // Bytes of queued console input
+#define SIM_UART_BUFFER_SIZE                1024    // Bytes of queued UART input or captured output
+#define SIM_UART_FIFO_SIZE                  32      // Depth of the simulated UART FIFOs
+#define SIM_UART_REPLY_IDLE_US              2000    // Line idle time that ends a captured reply
+
+/*!
+ * @brief Callback for output level changes on a GPIO pin
+ *
+ * @param gpio: pin number
+ * @param level: new output level
+ * @param time_us: virtual time of the change in microseconds
+ */
+typedef void (*sim_gpio_hook_t)(unsigned gpio, bool level, uint64_t time_us);
+
+/*!
+ * @brief Advance the virtual clock
+ *
+ * @param us: microseconds to advance by
+ * @return: none
+ */
+void sim_advance_us(uint32_t us);
+
+/*!
+ * @brief Queue a line of console input, a newline is appended
+ *
+ * @param line: pointer to line to queue
+ * @return: true on success, false if the input queue is full
+ */
+bool sim_input_push(const char* line);
+
+/*!
+ * @brief Get the number of queued console input characters
+ *
+ * @param: none
+ * @return: number of characters not yet read by the firmware
+ */
+int sim_input_pending(void);
+
+/*!
+ * @brief Drive the level seen on a simulated input pin
+ *
+ * @param gpio: pin number
+ * @param level: input level
+ * @return: none
+ */
+void sim_gpio_set_input(unsigned gpio, bool level);
+
+/*!
+ * @brief Get the current output level of a simulated pin
+ *
+ * @param gpio: pin number
+ * @return: output level
+ */
+bool sim_gpio_level(unsigned gpio);
+
+/*!
+ * @brief Install a hook called on every output level change
+ *
+ * @param hook: callback, NULL to remove
+ * @return: none
+ */
+void sim_set_gpio_hook(sim_gpio_hook_t hook);
+
+/*!
+ * @brief Set the rate of the simulated external step/dir input
+ *
+ * @param rate: external steps per second, negative counts down
+ * @return: none
+ */
+void sim_encoder_set_rate(double rate);
+
+/*!
+ * @brief Queue bytes to arrive on the simulated UART, one character time apart
+ *
+ * @param data: pointer to the bytes
+ * @param length: number of bytes
+ * @return: true on success, false if the input queue is full
+ */
+bool sim_uart_push(const uint8_t* data, int length);
+
+/*!
+ * @brief Take the bytes the firmware sent on the UART once the line has gone idle
+ *
+ * @param data: buffer for the bytes
+ * @param size: size of the buffer
+ * @return: number of bytes taken, 0 if none or the line is still busy
+ */
+int sim_uart_take_reply(uint8_t* data, int size);
+
+/*!
+ * @brief Check whether UART traffic is still in progress
+ *
+ * @param: none
+ * @return: true if input is unread, output is untaken or the line was recently active
+ */
+bool sim_uart_busy(void);
+
+#endif // SIM_HAL_H
@@ -0,0 +1,498 @@
+/**
+    * @file sim_main.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Host simulator that replays recorded command sessions into the firmware
+    * 
+    * Reads a session recorded on the device with "record dump" (one "<ms> <command>" line
+    * per command), feeds each command to the simulated console at its recorded time and
+    * runs the firmware superloop against a virtual 10 us tick. Lines of the form
+    * "<ms> !gpio <pin> <level>" drive a simulated input pin instead, e.g. the estop, and
+    * "<ms> !encoder <steps/s>" sets the rate of the simulated external step/dir input.
+    * "<ms> !modbus <hex bytes>" sends a Modbus RTU request on the simulated UART.
+    * The replay can run as fast as possible or paced to a multiple of real time, and
+    * ends with a timing report for the step engine. With --motor the STEP/DIR outputs also drive the motor and load
+    * model in sim_motor.c, which reports any steps the commanded motion would lose.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+
+#include "sys_timer.h"
+#include "stepper.h"
+#include "led.h"
+#include "command_processor.h"
+#include "encoder.h"
+#include "task.h"
+#include "claw_tasks.h"
+#include "modbus.h"
+#include "sim_hal.h"
+#include "sim_motor.h"
+
+#define SIM_MAX_COMMANDS                    4096    // Maximum number of commands in a session
+#define SIM_MAX_MOVES                       1024    // Maximum number of moves in the report
+#define SIM_LINE_LENGTH                     256     // Maximum session line length
+#define SIM_DEFAULT_TAIL_MS                 600000  // Default time to let the last move finish
+
+/*!
+ * @brief One recorded command
+ */
+typedef struct sim_command
+{
+    uint64_t time_us;                  //!< Time of the command from the start of the session
+    char text[SIM_LINE_LENGTH];        //!< Command text
+} sim_command_t;
+
+/*!
+ * @brief Timing record for one move
+ */
+typedef struct sim_move
+{
+    uint64_t start_us;       //!< Virtual time the move started
+    uint64_t end_us;         //!< Virtual time the move ended
+    int start_position;      //!< Position at the start of the move
+    int end_position;        //!< Position at the end of the move
+    int steps;               //!< Step pulses issued
+    uint64_t min_interval_us; //!< Shortest time between step pulses
+    uint64_t max_interval_us; //!< Longest time between step pulses
+} sim_move_t;
+
+static sim_command_t sim_commands[SIM_MAX_COMMANDS];
+static int sim_command_count = 0;
+static sim_move_t sim_moves[SIM_MAX_MOVES];
+static int sim_move_count = 0;
+static sim_move_t* sim_current_move = NULL;
+static uint64_t sim_last_step_us = 0;
+static uint64_t sim_total_steps = 0;
+
+static uint64_t sim_movement_calls = 0;
+static uint64_t sim_movement_total_ns = 0;
+static uint64_t sim_movement_max_ns = 0;
+static task_function_t sim_movement_run = NULL;
+
+/* -------------------------- helper functions -----------------------------*/
+static uint64_t sim_wall_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static bool sim_load_session(const char* path)
+{
+    char line[SIM_LINE_LENGTH + 32];
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        char* text;
+        unsigned long long time_ms;
+
+        // Strip line endings, skip blank lines and comments
+        line[strcspn(line, "\r\n")] = '\0';
+        if(line[0] == '\0' || line[0] == '#')
+        {
+            continue;
+        }
+
+        time_ms = strtoull(line, &text, 10);
+        if(text == line || *text != ' ')
+        {
+            fprintf(stderr, "%s: ignoring malformed line \"%s\"\n", path, line);
+            continue;
+        }
+
+        if(sim_command_count >= SIM_MAX_COMMANDS)
+        {
+            fprintf(stderr, "%s: more than %d commands, truncating\n", path, SIM_MAX_COMMANDS);
+            break;
+        }
+
+        sim_commands[sim_command_count].time_us = time_ms * 1000;
+        snprintf(sim_commands[sim_command_count].text, SIM_LINE_LENGTH, "%s", text + 1);
+        sim_command_count++;
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool sim_motor_model = false;
+
+static void sim_gpio_changed(unsigned gpio, bool level, uint64_t time_us)
+{
+    if(sim_motor_model)
+    {
+        sim_motor_gpio_changed(gpio, level, time_us);
+    }
+
+    // Count rising edges of the step pin
+    if(gpio != STEPPER_STEP_PIN || !level)
+    {
+        return;
+    }
+
+    sim_total_steps++;
+    if(sim_current_move != NULL)
+    {
+        if(sim_current_move->steps > 0)
+        {
+            uint64_t interval = time_us - sim_last_step_us;
+            if(sim_current_move->steps == 1 || interval < sim_current_move->min_interval_us)
+            {
+                sim_current_move->min_interval_us = interval;
+            }
+            if(interval > sim_current_move->max_interval_us)
+            {
+                sim_current_move->max_interval_us = interval;
+            }
+        }
+        sim_current_move->steps++;
+    }
+    sim_last_step_us = time_us;
+}
+
+static void sim_track_moves(stepper_state_t* stepper)
+{
+    if(stepper->moving && sim_current_move == NULL && sim_move_count < SIM_MAX_MOVES)
+    {
+        sim_current_move = &sim_moves[sim_move_count++];
+        memset(sim_current_move, 0, sizeof(*sim_current_move));
+        sim_current_move->start_us = time_us_64();
+        sim_current_move->start_position = stepper->current_position;
+    }
+    else if(!stepper->moving && sim_current_move != NULL)
+    {
+        sim_current_move->end_us = time_us_64();
+        sim_current_move->end_position = stepper->current_position;
+        sim_current_move = NULL;
+    }
+}
+
+/* -------------------------- simulated Modbus master -----------------------------*/
+/* Note: "!modbus <hex bytes>" sends a request frame, the CRC is appended here,   */
+/*       and each reply is printed as "modbus> <hex bytes>" once the line is idle.*/
+/* ----------------------------------------------------------------------------*/
+static uint16_t sim_modbus_crc(const uint8_t* data, int length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for(int i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for(int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static bool sim_modbus_request(const char* text)
+{
+    uint8_t frame[MODBUS_FRAME_SIZE];
+    int length = 0;
+    unsigned value;
+    int used;
+    uint16_t crc;
+
+    while(length < MODBUS_FRAME_SIZE - 2 && sscanf(text, " %2x%n", &value, &used) == 1)
+    {
+        frame[length++] = (uint8_t)value;
+        text += used;
+    }
+    crc = sim_modbus_crc(frame, length);
+    frame[length++] = (uint8_t)(crc & 0xFF);
+    frame[length++] = (uint8_t)(crc >> 8);
+    return sim_uart_push(frame, length);
+}
+
+static void sim_modbus_reply(void)
+{
+    uint8_t reply[MODBUS_FRAME_SIZE];
+    int length = sim_uart_take_reply(reply, sizeof(reply));
+
+    if(length == 0)
+    {
+        return;
+    }
+    printf("modbus>");
+    for(int i = 0; i < length; i++)
+    {
+        printf(" %02x", reply[i]);
+    }
+    printf("%s\n", (length >= 2 && sim_modbus_crc(reply, length) == 0) ? "" : " (bad CRC)");
+}
+
+/* -------------------------- simulated superloop -----------------------------*/
+/* Note: Runs the task list registered by claw_tasks_init(), as main() in claw.c */
+/*       does, once per virtual tick. The movement task is wrapped by            */
+/*       sim_timed_movement() to time the step engine on the host CPU.           */
+/* ----------------------------------------------------------------------------*/
+static bool sim_timed_movement(void* context)
+{
+    uint64_t start_ns = sim_wall_ns();
+    bool ran = sim_movement_run(context);
+    uint64_t elapsed_ns = sim_wall_ns() - start_ns;
+
+    // Only ticks the step engine ran on count
+    if(ran)
+    {
+        sim_movement_calls++;
+        sim_movement_total_ns += elapsed_ns;
+        if(elapsed_ns > sim_movement_max_ns)
+        {
+            sim_movement_max_ns = elapsed_ns;
+        }
+    }
+    return ran;
+}
+
+static void sim_superloop(void)
+{
+    if(ms_ticks_count > 0)
+    {
+        ms_ticks_count--;
+        task_run(TASK_RATE_MS);
+    }
+
+    if(ten_us_ticks_count > 0)
+    {
+        ten_us_ticks_count--;
+        task_run(TASK_RATE_TEN_US);
+    }
+}
+
+/* -------------------------- report -----------------------------*/
+static void sim_report(uint64_t wall_ns)
+{
+    uint64_t end_us = time_us_64();
+
+    fprintf(stderr, "\n==== Replay report ====\n");
+    fprintf(stderr, "Commands replayed:   %d\n", sim_command_count);
+    fprintf(stderr, "Virtual time:        %.3f s\n", end_us / 1e6);
+    fprintf(stderr, "Wall time:           %.3f s\n", wall_ns / 1e9);
+    fprintf(stderr, "Steps issued:        %llu\n", (unsigned long long)sim_total_steps);
+    fprintf(stderr, "Step engine calls:   %llu, mean %.1f ns, max %llu ns (host CPU)\n",
+            (unsigned long long)sim_movement_calls,
+            sim_movement_calls ? (double)sim_movement_total_ns / sim_movement_calls : 0.0,
+            (unsigned long long)sim_movement_max_ns);
+
+    fprintf(stderr, "\n%4s %11s %10s %8s %8s %7s %10s %9s %9s\n", "Move", "Start (ms)", "Time (ms)",
+            "From", "To", "Steps", "Rate (Hz)", "Min (us)", "Max (us)");
+    for(int i = 0; i < sim_move_count; i++)
+    {
+        sim_move_t* move = &sim_moves[i];
+        uint64_t move_end = (move->end_us != 0) ? move->end_us : end_us;
+        double duration_s = (move_end - move->start_us) / 1e6;
+
+        fprintf(stderr, "%4d %11.3f %10.3f %8d %8d %7d %10.0f %9llu %9llu%s\n", i,
+                move->start_us / 1e3, duration_s * 1e3, move->start_position,
+                (move->end_us != 0) ? move->end_position : 0, move->steps,
+                duration_s > 0 ? move->steps / duration_s : 0.0,
+                (unsigned long long)move->min_interval_us, (unsigned long long)move->max_interval_us,
+                (move->end_us != 0) ? "" : " (unfinished)");
+    }
+}
+
+static void sim_usage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <session file>\n"
+        "  -s, --speed <factor>  Replay at factor times real time, 0 for as fast as possible (default 0)\n"
+        "  -t, --tail <ms>       Time allowed for the last move to finish (default %d)\n"
+        "  -q, --quiet           Suppress the firmware console output\n"
+        "  -m, --motor           Drive the motor and load model and report lost steps\n"
+        "  -p, --param <n>=<v>   Set a motor model parameter, implies --motor\n"
+        "Motor model parameters and defaults:\n",
+        program, SIM_DEFAULT_TAIL_MS);
+    sim_motor_print_params();
+}
+
+/* -------------------------- main -----------------------------*/
+int main(int argc, char** argv)
+{
+    stepper_state_t stepper;
+    const char* session_path = NULL;
+    double speed = 0.0;
+    uint64_t tail_us = (uint64_t)SIM_DEFAULT_TAIL_MS * 1000;
+    uint64_t wall_start_ns;
+    uint64_t last_command_us;
+    int next_command = 0;
+    long lost_steps = 0;
+
+    sim_motor_init();
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--speed") == 0) && i + 1 < argc)
+        {
+            speed = atof(argv[++i]);
+        }
+        else if((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tail") == 0) && i + 1 < argc)
+        {
+            tail_us = strtoull(argv[++i], NULL, 10) * 1000;
+        }
+        else if(strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0)
+        {
+            if(freopen("/dev/null", "w", stdout) == NULL)
+            {
+                perror("/dev/null");
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--motor") == 0)
+        {
+            sim_motor_model = true;
+        }
+        else if((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--param") == 0) && i + 1 < argc)
+        {
+            char name[64];
+            double value;
+            if(sscanf(argv[++i], "%63[^=]=%lf", name, &value) != 2 || !sim_motor_set_param(name, value))
+            {
+                fprintf(stderr, "Invalid motor parameter \"%s\"\n", argv[i]);
+                sim_usage(argv[0]);
+                return 1;
+            }
+            sim_motor_model = true;
+        }
+        else if(argv[i][0] != '-' && session_path == NULL)
+        {
+            session_path = argv[i];
+        }
+        else
+        {
+            sim_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(session_path == NULL || speed < 0.0)
+    {
+        sim_usage(argv[0]);
+        return 1;
+    }
+
+    if(!sim_load_session(session_path))
+    {
+        return 1;
+    }
+
+    // Same start up as main() in claw.c, the estop input idles at its pulled up level
+    pico_led_init();
+    stdio_init_all();
+    stepper_init(&stepper, 0, DEFAULT_STEPPER_PERIOD);
+    modbus_init();
+    if(!claw_tasks_init(&stepper) || task_find("movement") == NULL)
+    {
+        fprintf(stderr, "Could not register the firmware tasks\n");
+        return 1;
+    }
+    sim_movement_run = task_find("movement")->run;
+    task_find("movement")->run = sim_timed_movement;
+    sim_set_gpio_hook(sim_gpio_changed);
+    printf("Claw Command Interface (simulated)\n");
+    printf("#: ");
+
+    last_command_us = (sim_command_count > 0) ? sim_commands[sim_command_count - 1].time_us : 0;
+    wall_start_ns = sim_wall_ns();
+
+    while(true)
+    {
+        uint64_t now_us = time_us_64();
+
+        // Feed commands due at this time into the console
+        while(next_command < sim_command_count && sim_commands[next_command].time_us <= now_us)
+        {
+            unsigned gpio;
+            int level;
+            double rate;
+
+            // Simulator directives drive inputs instead of the console
+            if(sscanf(sim_commands[next_command].text, "!gpio %u %d", &gpio, &level) == 2)
+            {
+                sim_gpio_set_input(gpio, level != 0);
+                next_command++;
+                continue;
+            }
+            if(sscanf(sim_commands[next_command].text, "!encoder %lf", &rate) == 1)
+            {
+                sim_encoder_set_rate(rate);
+                next_command++;
+                continue;
+            }
+            if(strncmp(sim_commands[next_command].text, "!modbus ", 8) == 0)
+            {
+                if(!sim_modbus_request(sim_commands[next_command].text + 8))
+                {
+                    break; // UART input queue full, retry on a later tick
+                }
+                next_command++;
+                continue;
+            }
+
+            if(!sim_input_push(sim_commands[next_command].text))
+            {
+                break; // Input queue full, retry on a later tick
+            }
+            next_command++;
+        }
+
+        // Finished once everything has been sent and consumed and the stepper is idle
+        if(next_command >= sim_command_count && sim_input_pending() == 0 &&
+           !stepper.moving && !command_is_pending() && !sim_uart_busy() && now_us >= last_command_us)
+        {
+            break;
+        }
+        if(now_us > last_command_us + tail_us)
+        {
+            fprintf(stderr, "Replay tail of %llu ms expired\n", (unsigned long long)(tail_us / 1000));
+            break;
+        }
+
+        // One virtual timer tick
+        sim_advance_us(TIMER_INTERVAL_US);
+        timer_callback(NULL);
+        sim_superloop();
+        if(sim_motor_model)
+        {
+            sim_motor_advance(TIMER_INTERVAL_US);
+        }
+        sim_track_moves(&stepper);
+        sim_modbus_reply();
+
+        // Pace to real time every virtual millisecond
+        if(speed > 0.0 && (now_us % 1000) == 0)
+        {
+            uint64_t due_ns = wall_start_ns + (uint64_t)(now_us * 1000.0 / speed);
+            uint64_t wall_ns = sim_wall_ns();
+            if(due_ns > wall_ns)
+            {
+                struct timespec delay = { (time_t)((due_ns - wall_ns) / 1000000000ull), (long)((due_ns - wall_ns) % 1000000000ull) };
+                nanosleep(&delay, NULL);
+            }
+        }
+    }
+
+    fflush(stdout);
+    sim_report(sim_wall_ns() - wall_start_ns);
+    if(sim_motor_model)
+    {
+        lost_steps = sim_motor_report();
+    }
+
+    // Non-zero exit status when the motion would lose steps, for scripted sweeps
+    return (lost_steps != 0) ? 2 : 0;
+}
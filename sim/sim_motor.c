@@ -0,0 +1,326 @@
+/**
+    * @file sim_motor.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the simulated stepper motor and load
+    * 
+    * This file contains the rotor dynamics, lost step detection and the motor report.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "stepper.h"
+#include "sim_hal.h"
+#include "sim_motor.h"
+
+#define SIM_MOTOR_TEETH_PER_FULL_STEP       4.0     // A hybrid stepper has one rotor tooth per 4 full steps
+#define SIM_MOTOR_MAX_STEP_GAP_US           100000  // Steps further apart than this start a new speed estimate
+#define SIM_MOTOR_SPEED_WINDOW              32      // Steps averaged for the speed estimate, smooths the tick quantised intervals
+#define SIM_MOTOR_SLIP_HYSTERESIS           0.75    // Tooth pitches of lag from the last settled tooth that count as a slip
+
+/*!
+ * @brief Record of one lost step event
+ */
+typedef struct sim_motor_event
+{
+    uint64_t time_us;         //!< Virtual time of the slip
+    int commanded_position;   //!< Commanded position in steps
+    int slipped_teeth;        //!< Teeth slipped, negative when the rotor fell behind going backward
+    double speed;             //!< Commanded speed in steps/s
+    double acceleration;      //!< Commanded acceleration in steps/s^2
+} sim_motor_event_t;
+
+static sim_motor_params_t sim_motor_params;
+
+static double sim_motor_commanded_angle = 0.0;  // Commanded rotor angle in rad
+static double sim_motor_angle = 0.0;            // Rotor angle in rad
+static double sim_motor_velocity = 0.0;         // Rotor velocity in rad/s
+static int sim_motor_commanded_position = 0;    // Commanded position in steps
+static int sim_motor_slip_teeth = 0;            // Teeth slipped so far
+
+static uint64_t sim_motor_step_times[SIM_MOTOR_SPEED_WINDOW];   // Times of recent steps in one direction
+static double sim_motor_window_speeds[SIM_MOTOR_SPEED_WINDOW];  // Speed estimates at those steps
+static double sim_motor_window_times[SIM_MOTOR_SPEED_WINDOW];   // Mid times of those estimates in s
+static int sim_motor_window_steps = 0;          // Steps in the window history
+static double sim_motor_last_direction = 0.0;
+static double sim_motor_step_speed = 0.0;       // Commanded speed in steps/s, signed
+static double sim_motor_step_accel = 0.0;       // Commanded acceleration in steps/s^2, signed
+
+static double sim_motor_peak_speed = 0.0;
+static double sim_motor_peak_accel = 0.0;
+static double sim_motor_max_lag = 0.0;          // Worst lag in full steps
+static double sim_motor_min_margin = INFINITY;  // Worst quasi-static torque margin in N m
+static double sim_motor_min_margin_speed = 0.0;
+static long sim_motor_overload_steps = 0;       // Steps where demanded torque exceeded available
+
+static sim_motor_event_t sim_motor_events[SIM_MOTOR_MAX_EVENTS];
+static int sim_motor_event_count = 0;
+
+/*!
+ * @brief Parameter name table for sim_motor_set_param()
+ */
+static const struct
+{
+    const char* name;
+    size_t offset;
+} sim_motor_param_names[] =
+{
+    { "full_steps_per_rev", offsetof(sim_motor_params_t, full_steps_per_rev) },
+    { "holding_torque",     offsetof(sim_motor_params_t, holding_torque) },
+    { "rotor_inertia",      offsetof(sim_motor_params_t, rotor_inertia) },
+    { "corner_speed",       offsetof(sim_motor_params_t, corner_speed) },
+    { "detent_friction",    offsetof(sim_motor_params_t, detent_friction) },
+    { "viscous_damping",    offsetof(sim_motor_params_t, viscous_damping) },
+    { "lead",               offsetof(sim_motor_params_t, lead) },
+    { "efficiency",         offsetof(sim_motor_params_t, efficiency) },
+    { "load_mass",          offsetof(sim_motor_params_t, load_mass) },
+    { "gravity",            offsetof(sim_motor_params_t, gravity) },
+};
+
+/* -------------------------- model helper functions -----------------------------*/
+static double sim_motor_step_angle(void)
+{
+    return 2.0 * M_PI / STEPPER_STEPS_PER_REV;
+}
+
+static double sim_motor_tooth_pitch(void)
+{
+    return 2.0 * M_PI * SIM_MOTOR_TEETH_PER_FULL_STEP / sim_motor_params.full_steps_per_rev;
+}
+
+// Rotor plus lead screw and load inertia reflected to the motor shaft
+static double sim_motor_total_inertia(void)
+{
+    double ratio = sim_motor_params.lead / (2.0 * M_PI);
+    return sim_motor_params.rotor_inertia + sim_motor_params.load_mass * ratio * ratio / sim_motor_params.efficiency;
+}
+
+// Torque the load weight applies to the shaft, positive pulls backward
+static double sim_motor_gravity_torque(void)
+{
+    return sim_motor_params.load_mass * sim_motor_params.gravity * sim_motor_params.lead / (2.0 * M_PI);
+}
+
+// Friction torque magnitude including the lead screw losses under load
+static double sim_motor_friction_torque(void)
+{
+    return sim_motor_params.detent_friction + fabs(sim_motor_gravity_torque()) * (1.0 / sim_motor_params.efficiency - 1.0);
+}
+
+// Peak torque available at a shaft speed in rad/s
+static double sim_motor_available_torque(double speed)
+{
+    double corner = sim_motor_params.corner_speed * 2.0 * M_PI;
+    speed = fabs(speed);
+    return (speed <= corner) ? sim_motor_params.holding_torque : sim_motor_params.holding_torque * corner / speed;
+}
+
+static bool sim_motor_enabled(void)
+{
+    return sim_gpio_level(STEPPER_ENABLE_PIN) != STEPPER_ENABLE_PIN_INVERTED;
+}
+
+/* -------------------------- model interface functions -----------------------------*/
+void sim_motor_init(void)
+{
+    sim_motor_params.full_steps_per_rev = 200.0;
+    sim_motor_params.holding_torque = 0.40;
+    sim_motor_params.rotor_inertia = 54e-7;
+    sim_motor_params.corner_speed = 3.0;
+    sim_motor_params.detent_friction = 0.02;
+    sim_motor_params.viscous_damping = 1e-4;
+    sim_motor_params.lead = 0.0254 / 20.0;
+    sim_motor_params.efficiency = 0.35;
+    sim_motor_params.load_mass = 0.5;
+    sim_motor_params.gravity = 9.81;
+}
+
+bool sim_motor_set_param(const char* name, double value)
+{
+    for(size_t i = 0; i < sizeof(sim_motor_param_names) / sizeof(sim_motor_param_names[0]); i++)
+    {
+        if(strcmp(name, sim_motor_param_names[i].name) == 0)
+        {
+            *(double*)((char*)&sim_motor_params + sim_motor_param_names[i].offset) = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_motor_print_params(void)
+{
+    for(size_t i = 0; i < sizeof(sim_motor_param_names) / sizeof(sim_motor_param_names[0]); i++)
+    {
+        fprintf(stderr, "  %-20s %g\n", sim_motor_param_names[i].name,
+                *(double*)((char*)&sim_motor_params + sim_motor_param_names[i].offset));
+    }
+}
+
+void sim_motor_gpio_changed(unsigned gpio, bool level, uint64_t time_us)
+{
+    double direction;
+
+    // Steps are taken on the rising edge of the step pin
+    if(gpio != STEPPER_STEP_PIN || !level)
+    {
+        return;
+    }
+
+    direction = (sim_gpio_level(STEPPER_DIR_PIN) == STEPPER_DIRECTION_FORWARD) ? 1.0 : -1.0;
+    sim_motor_commanded_angle += direction * sim_motor_step_angle();
+    sim_motor_commanded_position += (int)direction;
+
+    // Start a new estimate after a pause or a reversal
+    int slot = sim_motor_window_steps % SIM_MOTOR_SPEED_WINDOW;
+    int previous = (sim_motor_window_steps + SIM_MOTOR_SPEED_WINDOW - 1) % SIM_MOTOR_SPEED_WINDOW;
+    if(sim_motor_window_steps > 0 && (direction != sim_motor_last_direction ||
+       time_us - sim_motor_step_times[previous] > SIM_MOTOR_MAX_STEP_GAP_US))
+    {
+        sim_motor_window_steps = 0;
+        slot = 0;
+    }
+    sim_motor_last_direction = direction;
+
+    // Speed over the last window of steps, acceleration between successive windows
+    if(sim_motor_window_steps >= SIM_MOTOR_SPEED_WINDOW)
+    {
+        uint64_t window_start = sim_motor_step_times[slot];
+        double speed = direction * SIM_MOTOR_SPEED_WINDOW / ((time_us - window_start) / 1e6);
+        double mid_time = (time_us + window_start) / 2e6;
+        if(sim_motor_window_steps >= 2 * SIM_MOTOR_SPEED_WINDOW)
+        {
+            sim_motor_step_accel = (speed - sim_motor_window_speeds[slot]) / (mid_time - sim_motor_window_times[slot]);
+        }
+        sim_motor_step_speed = speed;
+        sim_motor_window_speeds[slot] = speed;
+        sim_motor_window_times[slot] = mid_time;
+    }
+    else
+    {
+        sim_motor_step_speed = 0.0;
+        sim_motor_step_accel = 0.0;
+    }
+    sim_motor_step_times[slot] = time_us;
+    sim_motor_window_steps++;
+
+    if(fabs(sim_motor_step_speed) > sim_motor_peak_speed)
+    {
+        sim_motor_peak_speed = fabs(sim_motor_step_speed);
+    }
+    if(fabs(sim_motor_step_accel) > sim_motor_peak_accel)
+    {
+        sim_motor_peak_accel = fabs(sim_motor_step_accel);
+    }
+
+    // Quasi-static check of the torque the commanded motion demands
+    double shaft_speed = sim_motor_step_speed * sim_motor_step_angle();
+    double shaft_accel = sim_motor_step_accel * sim_motor_step_angle();
+    double demanded = fabs(sim_motor_total_inertia() * shaft_accel + sim_motor_gravity_torque() + direction * sim_motor_friction_torque());
+    double margin = sim_motor_available_torque(shaft_speed) - demanded;
+    if(margin < sim_motor_min_margin)
+    {
+        sim_motor_min_margin = margin;
+        sim_motor_min_margin_speed = fabs(sim_motor_step_speed);
+    }
+    if(margin < 0.0)
+    {
+        sim_motor_overload_steps++;
+    }
+}
+
+void sim_motor_advance(uint32_t us)
+{
+    double dt = us / 1e6 / SIM_MOTOR_SUBSTEPS;
+    double inertia = sim_motor_total_inertia();
+    double tooth = sim_motor_tooth_pitch();
+    double teeth_per_rad = 2.0 * M_PI / tooth;
+
+    for(int substep = 0; substep < SIM_MOTOR_SUBSTEPS; substep++)
+    {
+        double drive = 0.0;
+        double friction = sim_motor_friction_torque();
+        double torque;
+
+        // Torque-angle curve pulls the nearest tooth towards the commanded angle
+        if(sim_motor_enabled())
+        {
+            double error = sim_motor_commanded_angle - sim_motor_angle;
+            drive = sim_motor_available_torque(sim_motor_velocity) * sin(error * teeth_per_rad);
+        }
+        torque = drive - sim_motor_gravity_torque() - sim_motor_params.viscous_damping * sim_motor_velocity;
+
+        // Coulomb friction, holding the rotor still if it cannot overcome it
+        if(fabs(sim_motor_velocity) < 1e-6 && fabs(torque) <= friction)
+        {
+            sim_motor_velocity = 0.0;
+            continue;
+        }
+        torque -= (sim_motor_velocity != 0.0 ? (sim_motor_velocity > 0.0 ? friction : -friction) : (torque > 0.0 ? friction : -friction));
+
+        // Semi-implicit Euler keeps the torque-angle spring stable
+        sim_motor_velocity += torque / inertia * dt;
+        sim_motor_angle += sim_motor_velocity * dt;
+    }
+
+    // Lag in tooth pitches, the rotor has slipped once it settles on a different tooth
+    double lag = (sim_motor_commanded_angle - sim_motor_angle) / tooth;
+    double lag_full_steps = fabs(lag) * SIM_MOTOR_TEETH_PER_FULL_STEP;
+    if(sim_motor_enabled() && lag_full_steps > sim_motor_max_lag)
+    {
+        sim_motor_max_lag = lag_full_steps;
+    }
+
+    if(fabs(lag - sim_motor_slip_teeth) > SIM_MOTOR_SLIP_HYSTERESIS)
+    {
+        int slip = (int)lround(lag);
+        if(sim_motor_event_count < SIM_MOTOR_MAX_EVENTS)
+        {
+            sim_motor_event_t* event = &sim_motor_events[sim_motor_event_count];
+            event->time_us = time_us_64();
+            event->commanded_position = sim_motor_commanded_position;
+            event->slipped_teeth = slip - sim_motor_slip_teeth;
+            event->speed = sim_motor_step_speed;
+            event->acceleration = sim_motor_step_accel;
+        }
+        sim_motor_event_count++;
+        sim_motor_slip_teeth = slip;
+    }
+}
+
+long sim_motor_report(void)
+{
+    double steps_per_tooth = STEPPER_STEPS_PER_REV * SIM_MOTOR_TEETH_PER_FULL_STEP / sim_motor_params.full_steps_per_rev;
+    long lost_steps = lround(fabs((double)sim_motor_slip_teeth) * steps_per_tooth);
+    double step_to_rad = sim_motor_step_angle();
+
+    fprintf(stderr, "\n==== Motor model ====\n");
+    sim_motor_print_params();
+    fprintf(stderr, "Reflected inertia:   %.3g kg m^2\n", sim_motor_total_inertia());
+    fprintf(stderr, "Peak command speed:  %.0f steps/s\n", sim_motor_peak_speed);
+    fprintf(stderr, "Peak command accel:  %.0f steps/s^2\n", sim_motor_peak_accel);
+    fprintf(stderr, "Worst rotor lag:     %.2f full steps\n", sim_motor_max_lag);
+    if(isfinite(sim_motor_min_margin))
+    {
+        fprintf(stderr, "Worst torque margin: %.3f N m at %.0f steps/s\n", sim_motor_min_margin, sim_motor_min_margin_speed);
+    }
+    fprintf(stderr, "Overloaded steps:    %ld (demanded torque above available)\n", sim_motor_overload_steps);
+    fprintf(stderr, "Slip events:         %d\n", sim_motor_event_count);
+    fprintf(stderr, "Net lost steps:      %ld\n", lost_steps);
+
+    for(int i = 0; i < sim_motor_event_count && i < SIM_MOTOR_MAX_EVENTS; i++)
+    {
+        sim_motor_event_t* event = &sim_motor_events[i];
+        double shaft_speed = event->speed * step_to_rad;
+        fprintf(stderr, "  %10.3f ms  position %7d  slipped %+d teeth  speed %8.0f steps/s  accel %10.0f steps/s^2  torque %.3f N m\n",
+                event->time_us / 1e3, event->commanded_position, event->slipped_teeth, event->speed, event->acceleration,
+                sim_motor_available_torque(shaft_speed));
+    }
+    return lost_steps;
+}
@@ -0,0 +1,96 @@
+/**
+    * @file sim_motor.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the simulated stepper motor and load
+    * 
+    * The motor model consumes the STEP, DIR and ENABLE outputs of the firmware. The rotor
+    * is pulled towards the commanded angle by the torque-angle curve of a hybrid stepper,
+    * with the peak torque falling with speed beyond the corner speed, against the rotor
+    * and reflected lead screw inertia, friction and the weight of the claw. If the rotor
+    * lags the commanded angle by more than half a tooth pitch it slips a tooth and steps
+    * are lost, which is reported with the commanded speed and acceleration at the time.
+*/
+
+#ifndef SIM_MOTOR_H
+#define SIM_MOTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_MOTOR_MAX_EVENTS                32      // Lost step events kept for the report
+#define SIM_MOTOR_SUBSTEPS                  4       // Integration substeps per advance
+
+/*!
+ * @brief Motor, lead screw and load parameters
+ */
+typedef struct sim_motor_params
+{
+    double full_steps_per_rev;    //!< Full steps per revolution (200 for 1.8 degree)
+    double holding_torque;        //!< Peak holding torque in N m
+    double rotor_inertia;         //!< Rotor inertia in kg m^2
+    double corner_speed;          //!< Speed in rev/s above which torque falls as 1/speed
+    double detent_friction;       //!< Motor and bearing friction torque in N m
+    double viscous_damping;       //!< Viscous damping in N m s/rad
+    double lead;                  //!< Lead screw travel per revolution in m
+    double efficiency;            //!< Lead screw efficiency, 0 to 1
+    double load_mass;             //!< Moving mass in kg
+    double gravity;               //!< Gravity along the axis in m/s^2, positive pulls backward
+} sim_motor_params_t;
+
+/*!
+ * @brief Initialise the motor model with default parameters
+ *
+ * @note: Defaults are a NEMA 17 on a 20 TPI lead screw lifting a 0.5 kg claw.
+ *
+ * @param: none
+ * @return: none
+ */
+void sim_motor_init(void);
+
+/*!
+ * @brief Set a named motor parameter
+ *
+ * @param name: parameter name, as the sim_motor_params_t field
+ * @param value: new value
+ * @return: true on success, false if the name is unknown
+ */
+bool sim_motor_set_param(const char* name, double value);
+
+/*!
+ * @brief Print the motor parameters and their names
+ *
+ * @param: none
+ * @return: none
+ */
+void sim_motor_print_params(void);
+
+/*!
+ * @brief Feed a GPIO output change to the motor
+ *
+ * @param gpio: pin number
+ * @param level: new output level
+ * @param time_us: virtual time of the change in microseconds
+ * @return: none
+ */
+void sim_motor_gpio_changed(unsigned gpio, bool level, uint64_t time_us);
+
+/*!
+ * @brief Advance the rotor dynamics
+ *
+ * @param us: microseconds to advance by
+ * @return: none
+ */
+void sim_motor_advance(uint32_t us);
+
+/*!
+ * @brief Print the motor model report
+ *
+ * @param: none
+ * @return: total number of lost microsteps
+ */
+long sim_motor_report(void);
+
+#endif // SIM_MOTOR_H
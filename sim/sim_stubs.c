@@ -0,0 +1,53 @@
+/**
+    * @file sim_stubs.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Simulator versions of firmware modules that need real hardware
+    * 
+    * The sampling profiler relies on the Cortex-M exception frame so is not available
+    * in the simulator, its commands report failure. The external step/dir counter runs
+    * at a rate set by the session instead of counting PIO input edges.
+*/
+
+#include "pico/stdlib.h"
+#include "profiler.h"
+#include "encoder.h"
+#include "sim_hal.h"
+
+static double sim_encoder_rate = 0.0;
+static double sim_encoder_base = 0.0;
+static uint64_t sim_encoder_base_us = 0;
+
+bool profiler_start(void)
+{
+    return false;
+}
+
+bool profiler_stop(void)
+{
+    return false;
+}
+
+bool profiler_dump(void)
+{
+    return false;
+}
+
+bool encoder_init(void)
+{
+    return true;
+}
+
+int32_t encoder_get_count(void)
+{
+    return (int32_t)(sim_encoder_base + sim_encoder_rate * (time_us_64() - sim_encoder_base_us) * 1e-6);
+}
+
+void sim_encoder_set_rate(double rate)
+{
+    sim_encoder_base += sim_encoder_rate * (time_us_64() - sim_encoder_base_us) * 1e-6;
+    sim_encoder_base_us = time_us_64();
+    sim_encoder_rate = rate;
+}
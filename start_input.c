@@ -0,0 +1,164 @@
+/**
+    * @file start_input.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the hardware move start input
+    * 
+    * This file contains the start edge interrupt handler and the arm and start functions.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "start_input.h"
+#include "event_log.h"
+
+#define START_INPUT_EDGE_EVENTS             (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
+
+static uint32_t start_event = GPIO_IRQ_EDGE_FALL;
+static volatile bool start_pending = false;
+static volatile uint32_t start_edge_us = 0;
+static volatile start_input_status_t start_status = { false, false, START_MOVE_ABSOLUTE, 0, START_INPUT_EDGE_FALLING, 0, 0, 0 };
+
+/* -------------------------- start input interrupt -----------------------------*/
+/* Note: The handler only timestamps the edge. The move is started from the      */
+/* superloop so the stepper state keeps a single writer.                         */
+/* ------------------------------------------------------------------------------*/
+static void start_input_irq_handler(void)
+{
+    uint32_t events = gpio_get_irq_event_mask(START_INPUT_PIN) & START_INPUT_EDGE_EVENTS;
+
+    if( events == 0 )
+    {
+        return;
+    }
+    gpio_acknowledge_irq(START_INPUT_PIN, events);
+
+    // A second edge before the first has been serviced starts nothing more
+    if( !start_status.armed || (events & start_event) == 0 || start_pending )
+    {
+        return;
+    }
+
+    if( !start_status.repeat )
+    {
+        gpio_set_irq_enabled(START_INPUT_PIN, START_INPUT_EDGE_EVENTS, false);
+        start_status.armed = false;
+    }
+    start_edge_us = time_us_32();
+    start_pending = true;
+}
+
+/* -------------------------- start input functions -----------------------------*/
+bool start_input_arm(int mode, int steps, int edge, bool repeat)
+{
+    static bool start_input_initialized = false;
+
+    if( (mode != START_MOVE_ABSOLUTE && mode != START_MOVE_RELATIVE) ||
+        (edge != START_INPUT_EDGE_FALLING && edge != START_INPUT_EDGE_RISING) )
+    {
+        return false;
+    }
+
+    if( mode == START_MOVE_ABSOLUTE && (steps < MIN_STEPPER_POSITION || steps > MAX_STEPPER_POSITION) )
+    {
+        return false;
+    }
+
+    if( !start_input_initialized )
+    {
+        gpio_init(START_INPUT_PIN);
+        gpio_set_dir(START_INPUT_PIN, GPIO_IN);
+        gpio_pull_up(START_INPUT_PIN);
+        gpio_add_raw_irq_handler(START_INPUT_PIN, start_input_irq_handler);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+        start_input_initialized = true;
+    }
+
+    // Disarm while the move is changed so an edge never starts half the new settings
+    gpio_set_irq_enabled(START_INPUT_PIN, START_INPUT_EDGE_EVENTS, false);
+    start_pending = false;
+    start_event = (edge == START_INPUT_EDGE_RISING) ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    start_status.mode = mode;
+    start_status.steps = steps;
+    start_status.edge = edge;
+    start_status.repeat = repeat;
+    start_status.starts = 0;
+    start_status.missed = 0;
+    start_status.armed = true;
+
+    // Discard any edge latched while the input was disarmed
+    gpio_acknowledge_irq(START_INPUT_PIN, START_INPUT_EDGE_EVENTS);
+    gpio_set_irq_enabled(START_INPUT_PIN, start_event, true);
+    return true;
+}
+
+bool start_input_disarm(void)
+{
+    if( !start_status.armed )
+    {
+        return false;
+    }
+
+    gpio_set_irq_enabled(START_INPUT_PIN, START_INPUT_EDGE_EVENTS, false);
+    start_status.armed = false;
+    start_pending = false;
+    return true;
+}
+
+bool start_input_get_status(start_input_status_t* status)
+{
+    if( status == NULL )
+    {
+        return false;
+    }
+
+    status->armed = start_status.armed;
+    status->repeat = start_status.repeat;
+    status->mode = start_status.mode;
+    status->steps = start_status.steps;
+    status->edge = start_status.edge;
+    status->starts = start_status.starts;
+    status->missed = start_status.missed;
+    status->last_latency_us = start_status.last_latency_us;
+    return true;
+}
+
+bool process_start_input(stepper_state_t* stepper)
+{
+    int target_position;
+
+    if( !start_pending || stepper == NULL )
+    {
+        return false;
+    }
+    start_pending = false;
+
+    // Never retarget a move in progress, the edge is counted as missed instead
+    if( stepper->moving || !stepper->enabled )
+    {
+        start_status.missed++;
+        EVENT_LOG("Start input missed at %d", stepper->current_position);
+        return false;
+    }
+
+    target_position = start_status.steps;
+    if( start_status.mode == START_MOVE_RELATIVE )
+    {
+        target_position += stepper->current_position;
+    }
+
+    if( !stepper_set_target_position(stepper, target_position) )
+    {
+        start_status.missed++;
+        EVENT_LOG("Start input refused target %d", target_position);
+        return false;
+    }
+
+    start_status.starts++;
+    start_status.last_latency_us = time_us_32() - start_edge_us;
+    EVENT_LOG("Start input move to %d after %u us", target_position, start_status.last_latency_us);
+    return true;
+}
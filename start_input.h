@@ -0,0 +1,79 @@
+/**
+    * @file start_input.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the hardware move start input
+    * 
+    * A move is armed ahead of time and started by an edge on the start input, e.g. from a
+    * PLC when a part arrives, without a round trip through the host and USB serial.
+*/
+
+#ifndef START_INPUT_H
+#define START_INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stepper.h"
+
+#define START_INPUT_PIN                     18      // GPIO pin for the move start input, pulled up
+#define START_INPUT_EDGE_FALLING            0       // Start when the input goes low
+#define START_INPUT_EDGE_RISING             1       // Start when the input goes high
+#define START_MOVE_ABSOLUTE                 0       // Armed move goes to an absolute position
+#define START_MOVE_RELATIVE                 1       // Armed move goes a number of steps from where it starts
+
+/*!
+ * @brief State of the start input and the armed move
+ */
+typedef struct start_input_status
+{
+    bool armed;                         //!< Waiting for a start edge
+    bool repeat;                        //!< Stays armed after each start
+    int mode;                           //!< START_MOVE_ABSOLUTE or START_MOVE_RELATIVE
+    int steps;                          //!< Target position or relative steps
+    int edge;                           //!< START_INPUT_EDGE_FALLING or START_INPUT_EDGE_RISING
+    uint32_t starts;                    //!< Moves started by the input
+    uint32_t missed;                    //!< Edges that could not start a move, e.g. still moving
+    uint32_t last_latency_us;           //!< Time from the last edge to its move starting
+} start_input_status_t;
+
+/*!
+ * @brief Arm a move to start on the next edge of the start input
+ *
+ * @param mode: START_MOVE_ABSOLUTE or START_MOVE_RELATIVE
+ * @param steps: target position, or relative steps from the position when the edge arrives
+ * @param edge: START_INPUT_EDGE_FALLING or START_INPUT_EDGE_RISING
+ * @param repeat: stay armed and start the same move on every edge
+ * @return: true on success, false on invalid parameters
+ */
+bool start_input_arm(int mode, int steps, int edge, bool repeat);
+
+/*!
+ * @brief Disarm the start input
+ *
+ * @param: none
+ * @return: true on success, false if no move was armed
+ */
+bool start_input_disarm(void);
+
+/*!
+ * @brief Get the state of the start input
+ *
+ * @param status: pointer to the structure to fill
+ * @return: true on success, false on invalid parameters
+ */
+bool start_input_get_status(start_input_status_t* status);
+
+/*!
+ * @brief Start the armed move once the start input has seen its edge
+ *
+ * @note: Called every 10 us tick before the step engine, so the first step of the
+ * move is issued on the tick after the edge.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if a move was started, false otherwise
+ */
+bool process_start_input(stepper_state_t* stepper);
+
+#endif // START_INPUT_H
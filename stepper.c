@@ -9,10 +9,99 @@
     * This file contains the implementation of functions for controlling a stepper motor.
 */
 
+#include <math.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "stepper.h"
 #include "sys_timer.h"
+#include "event_log.h"
+
+/* -------------------------- stepper state seqlock -----------------------------*/
+/* Note: The writer bumps the sequence count to odd before an update and back to   */
+/* even afterwards. A reader retries if the count was odd or changed during its    */
+/* copy. The barriers order the count against the state on both sides.             */
+/* --------------------------------------------------------------------------------*/
+void stepper_write_begin(stepper_state_t* stepper)
+{
+    stepper->sequence++;
+    __dmb();
+}
+
+void stepper_write_end(stepper_state_t* stepper)
+{
+    __dmb();
+    stepper->sequence++;
+}
+
+bool stepper_get_snapshot(const stepper_state_t* stepper, stepper_snapshot_t* snapshot)
+{
+    uint32_t sequence;
+
+    if( stepper == NULL || snapshot == NULL )
+    {
+        return false;
+    }
+
+    for(int attempt = 0; attempt < STEPPER_SNAPSHOT_RETRIES; attempt++)
+    {
+        sequence = stepper->sequence;
+        if(sequence & 1)
+        {
+            continue; // Update in progress
+        }
+        __dmb();
+
+        snapshot->current_position = stepper->current_position;
+        snapshot->target_position = stepper->target_position;
+        snapshot->step_period = stepper->step_period;
+        snapshot->moving = stepper->moving;
+        snapshot->enabled = stepper->enabled;
+        snapshot->velocity = stepper->velocity;
+        snapshot->direction = stepper->direction;
+        snapshot->acceleration = stepper->acceleration;
+        snapshot->deceleration = stepper->deceleration;
+        snapshot->feed_override = stepper->feed_override;
+        snapshot->estop_mode = stepper->estop_mode;
+        snapshot->estop_deceleration = stepper->estop_deceleration;
+        snapshot->estop_stopping = stepper->estop_stopping;
+        snapshot->backlash_steps = stepper->backlash_steps;
+        snapshot->backlash_slack = stepper->backlash_slack;
+        snapshot->approach_mode = stepper->approach_mode;
+        snapshot->approach_steps = stepper->approach_steps;
+        snapshot->approach_target = stepper->approach_target;
+        snapshot->approach_pending = stepper->approach_pending;
+        for(int i = 0; i < STEPPER_MAX_SPEED_ZONES; i++)
+        {
+            snapshot->speed_zones[i] = stepper->speed_zones[i];
+        }
+        for(int i = 0; i < STEPPER_MAX_ACCEL_POINTS; i++)
+        {
+            snapshot->accel_points[i] = stepper->accel_points[i];
+        }
+        snapshot->accel_point_count = stepper->accel_point_count;
+        snapshot->plan_hits = stepper->plan_hits;
+        snapshot->plan_misses = stepper->plan_misses;
+        snapshot->plan_retargets = stepper->plan_retargets;
+        snapshot->gear_enabled = stepper->gear_enabled;
+        snapshot->gear_numerator = stepper->gear_numerator;
+        snapshot->gear_denominator = stepper->gear_denominator;
+        snapshot->track_enabled = stepper->track_enabled;
+        snapshot->track_setpoint = stepper->track_setpoint;
+        snapshot->track_setpoints = stepper->track_setpoints;
+        for(int i = 0; i < STEPPER_MAX_TRIGGERS; i++)
+        {
+            snapshot->triggers[i] = stepper->triggers[i];
+        }
+
+        __dmb();
+        if(stepper->sequence == sequence)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
 /* -------------------------- stepper helper functions -----------------------------*/
 bool stepper_init(stepper_state_t* stepper, int initial_position, int step_period)
@@ -32,11 +121,73 @@ bool stepper_init(stepper_state_t* stepper, int initial_position, int step_perio
         return false;
     }
 
+    stepper->sequence = 0;
+    stepper->validate_only = false;
     stepper->current_position = initial_position;
     stepper->target_position = initial_position;
     stepper->step_period = step_period;
     stepper->moving = false;
     stepper->enabled = false;
+    stepper->velocity = 0.0f;
+    stepper->direction = STEPPER_DIRECTION_FORWARD;
+    stepper->acceleration = STEPPER_DEFAULT_ACCELERATION;
+    stepper->deceleration = STEPPER_DEFAULT_DECELERATION;
+    stepper->feed_override = STEPPER_DEFAULT_FEED_OVERRIDE;
+    stepper->estop_mode = STEPPER_DEFAULT_ESTOP_MODE;
+    stepper->estop_deceleration = STEPPER_DEFAULT_ESTOP_DECELERATION;
+    stepper->estop_stopping = false;
+    stepper->backlash_steps = 0;
+    stepper->backlash_slack = 0;
+    stepper->approach_mode = STEPPER_APPROACH_OFF;
+    stepper->approach_steps = STEPPER_DEFAULT_APPROACH_STEPS;
+    stepper->approach_target = initial_position;
+    stepper->approach_pending = false;
+    for(int i = 0; i < STEPPER_MAX_SPEED_ZONES; i++)
+    {
+        stepper->speed_zones[i].start = 0;
+        stepper->speed_zones[i].end = 0;
+        stepper->speed_zones[i].max_speed = 0;
+    }
+    stepper->speed_zone_count = 0;
+    stepper->accel_point_count = 0;
+    stepper->profile_version = 0;
+    for(int i = 0; i <= STEPPER_PLAN_CACHE_SIZE; i++)
+    {
+        stepper->plan_cache[i].last_used = 0;
+    }
+    stepper->plan_index = STEPPER_NO_PLAN;
+    stepper->plan_clock = 0;
+    stepper->plan_hits = 0;
+    stepper->plan_misses = 0;
+    stepper->plan_retargets = 0;
+    stepper->plan_retarget = false;
+    stepper->gear_enabled = false;
+    stepper->gear_numerator = 1;
+    stepper->gear_denominator = 1;
+    stepper->gear_origin_count = 0;
+    stepper->gear_origin_position = initial_position;
+    stepper->gear_speed = 0.0f;
+    stepper->gear_speed_ticks = 0;
+    stepper->gear_speed_start = initial_position;
+    stepper->track_enabled = false;
+    stepper->track_setpoint = initial_position;
+    stepper->track_origin = initial_position;
+    stepper->track_ticks = STEPPER_TRACK_MAX_INTERVAL_TICKS + 1;
+    stepper->track_interval = 1;
+    stepper->track_position = initial_position;
+    stepper->track_fraction = 0.0f;
+    stepper->track_velocity = 0.0f;
+    stepper->track_setpoints = 0;
+    for(int i = 0; i < STEPPER_MAX_TRIGGERS; i++)
+    {
+        stepper->triggers[i].pin = STEPPER_TRIGGER_UNUSED;
+        stepper->triggers[i].ticks_left = 0;
+        stepper->triggers[i].fire_count = 0;
+    }
+    stepper->trigger_count = 0;
+    stepper->trigger_pulses = 0;
+    stepper->step_phase = 0.0f;
+    stepper->step_pin_high = false;
     stepper_enable(stepper, false); // Disable stepper motor initially
 
     // Initialise optional GPIO pins for stepper status LEDs and estop input
@@ -65,8 +216,77 @@ bool stepper_set_target_position(stepper_state_t* stepper, int target_position)
         return false;
     } 
 
+    // No new moves while braking for an estop
+    if( stepper->estop_stopping )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->gear_enabled = false;
+    stepper->track_enabled = false;
+    stepper->approach_pending = false;
+    stepper->approach_target = target_position;
+
+    // Overshoot a target that would otherwise be reached travelling the wrong way
+    if( (stepper->approach_mode == STEPPER_APPROACH_FORWARD && target_position < stepper->current_position) ||
+        (stepper->approach_mode == STEPPER_APPROACH_BACKWARD && target_position > stepper->current_position) )
+    {
+        int overshoot = target_position + ((stepper->approach_mode == STEPPER_APPROACH_FORWARD) ? -stepper->approach_steps : stepper->approach_steps);
+        if( overshoot < MIN_STEPPER_POSITION )
+        {
+            overshoot = MIN_STEPPER_POSITION;
+        }
+        else if( overshoot > MAX_STEPPER_POSITION )
+        {
+            overshoot = MAX_STEPPER_POSITION;
+        }
+        stepper->approach_pending = (overshoot != target_position);
+        target_position = overshoot;
+    }
+
+    // A move retargeted while moving is planned from wherever it has got to
+    stepper->plan_retarget = stepper->moving && stepper->velocity != 0.0f;
+    if( stepper->plan_retarget )
+    {
+        stepper->plan_retargets++;
+    }
     stepper->target_position = target_position;
+    stepper->plan_index = STEPPER_NO_PLAN;
     stepper->moving = true;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_set_current_position(stepper_state_t* stepper, int position)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( position < MIN_STEPPER_POSITION || position > MAX_STEPPER_POSITION )
+    {
+        return false;
+    }
+
+    // Zeroing a moving stepper would stop it dead, bypassing the deceleration
+    if( stepper->moving || stepper->estop_stopping )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->current_position = position;
+    stepper->target_position = position;
+    stepper->approach_pending = false;
+    stepper->gear_enabled = false;
+    stepper->track_enabled = false;
+    stepper->plan_index = STEPPER_NO_PLAN;
+    stepper->moving = false;
+    stepper->velocity = 0.0f;
+    stepper->step_phase = 0.0f;
+    stepper_write_end(stepper);
     return true;
 }
 
@@ -82,199 +302,1484 @@ bool stepper_set_step_period(stepper_state_t* stepper, int step_period_us)
         return false;
     }
 
+    stepper_write_begin(stepper);
     stepper->step_period = step_period_us / TIMER_INTERVAL_US;
+    stepper->profile_version++;
+    stepper_write_end(stepper);
     return true;
 }
 
-bool stepper_stop(stepper_state_t* stepper)
+bool stepper_set_acceleration(stepper_state_t* stepper, int acceleration)
 {
     if( stepper == NULL )
     {
         return false;
     }
 
-    stepper->target_position = stepper->current_position;
-    stepper->moving = false;
+    if( acceleration < STEPPER_MIN_ACCELERATION || acceleration > STEPPER_MAX_ACCELERATION )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->acceleration = acceleration;
+    stepper_write_end(stepper);
     return true;
 }
 
-bool stepper_enable(stepper_state_t* stepper, bool enable)
+bool stepper_set_deceleration(stepper_state_t* stepper, int deceleration)
 {
-    static bool gpio_initialized = false;
-    if(!gpio_initialized)
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( deceleration < STEPPER_MIN_ACCELERATION || deceleration > STEPPER_MAX_ACCELERATION )
     {
-        gpio_init(STEPPER_ENABLE_PIN);
-        gpio_set_dir(STEPPER_ENABLE_PIN, GPIO_OUT);
-        gpio_initialized = true;
+        return false;
     }
 
+    stepper_write_begin(stepper);
+    stepper->deceleration = deceleration;
+    stepper->profile_version++;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_set_estop_mode(stepper_state_t* stepper, int mode, int deceleration)
+{
     if( stepper == NULL )
     {
         return false;
     }
 
-    gpio_put(STEPPER_ENABLE_PIN, enable ? (1 ^ STEPPER_ENABLE_PIN_INVERTED) : (0 ^ STEPPER_ENABLE_PIN_INVERTED)); // Enable or disable the stepper motor
-    stepper->enabled = enable;
+    if( mode != STEPPER_ESTOP_MODE_INSTANT && mode != STEPPER_ESTOP_MODE_DECEL )
+    {
+        return false;
+    }
+
+    if( deceleration < STEPPER_MIN_ACCELERATION || deceleration > STEPPER_MAX_ACCELERATION )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->estop_mode = mode;
+    stepper->estop_deceleration = deceleration;
+    stepper_write_end(stepper);
     return true;
 }
 
+bool stepper_set_backlash(stepper_state_t* stepper, int steps)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( steps < 0 || steps > STEPPER_MAX_BACKLASH_STEPS )
+    {
+        return false;
+    }
 
+    // Assume the backlash is taken up on the side of the last direction of travel
+    stepper_write_begin(stepper);
+    stepper->backlash_steps = steps;
+    stepper->backlash_slack = (stepper->direction == STEPPER_DIRECTION_FORWARD) ? steps : 0;
+    stepper->profile_version++;
+    stepper_write_end(stepper);
+    return true;
+}
 
-bool stepper_is_estop_active(stepper_state_t* stepper)
+bool stepper_set_approach(stepper_state_t* stepper, int mode, int steps)
 {
     if( stepper == NULL )
     {
         return false;
     }
 
-    // Read estop input pin
-    if(gpio_get(STEPPER_ESTOP_PIN) == STEPPER_ESTOP_ACTIVE_LEVEL)
+    if( mode != STEPPER_APPROACH_OFF && mode != STEPPER_APPROACH_FORWARD && mode != STEPPER_APPROACH_BACKWARD )
     {
-        return true;
+        return false;
     }
-    else
+
+    if( steps < 1 || steps > STEPPER_STEPS_PER_REV )
     {
         return false;
     }
+
+    stepper_write_begin(stepper);
+    stepper->approach_mode = mode;
+    stepper->approach_steps = steps;
+    stepper_write_end(stepper);
+    return true;
 }
 
-bool process_stepper_estop(stepper_state_t* stepper)
+bool stepper_set_speed_zone(stepper_state_t* stepper, int index, int start, int end, int max_speed)
 {
-    static int extop_active_count = 0;
+    int count = 0;
 
     if( stepper == NULL )
     {
         return false;
     }
 
-    // Read estop input pin
-    if(gpio_get(STEPPER_ESTOP_PIN) == STEPPER_ESTOP_ACTIVE_LEVEL)
+    if( index < 0 || index >= STEPPER_MAX_SPEED_ZONES )
     {
-        // Estop is active, disable stepper motor
-        stepper_enable(stepper, false);
-        gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL);
-        stepper->moving = false; // Stop any movement
-        stepper->target_position = stepper->current_position; // Set target to current position
-        extop_active_count = STEPPER_ESTOP_DEACTIVATE_DELAY_MS; // Reset deactivate delay counter
-        return true;
+        return false;
     }
-    else
+
+    if( max_speed < 0 || max_speed > STEPPER_MAX_SPEED )
     {
-        // Decrement estop deactivate delay counter
-        if(extop_active_count > 0)
+        return false;
+    }
+
+    if( max_speed > 0 && (start < MIN_STEPPER_POSITION || end > MAX_STEPPER_POSITION || end < start) )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->speed_zones[index].start = start;
+    stepper->speed_zones[index].end = end;
+    stepper->speed_zones[index].max_speed = max_speed;
+
+    // Zones in use are checked every tick, keep the count so an empty table costs nothing
+    for(int i = 0; i < STEPPER_MAX_SPEED_ZONES; i++)
+    {
+        if(stepper->speed_zones[i].max_speed > 0)
         {
-            extop_active_count--;
-            // Keep estop active until delay expires
-            gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL);
-            return true;
+            count = i + 1;
         }
-        else
+    }
+    stepper->speed_zone_count = count;
+    stepper->profile_version++;
+    stepper_write_end(stepper);
+    return true;
+}
+
+/* -------------------------- speed dependent acceleration table -----------------------------*/
+/* Note: While speeding up the acceleration is interpolated linearly between points. Braking   */
+/* in each segment uses the lower of its two points so the distance to stop from any speed is  */
+/* a sum of (v1^2 - v0^2) / 2d terms. These are tabulated when the table changes, which keeps  */
+/* the per tick stop distance and braking speed lookups to a short scan and one square root.   */
+/* Below the first point and above the last the nearest point applies.                         */
+/* --------------------------------------------------------------------------------------------*/
+
+/*!
+ * @brief Derive the stop distance and braking deceleration of each table point
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: none
+ */
+static void stepper_update_accel_table(stepper_state_t* stepper)
+{
+    float distance = 0.0f;
+    float speed = 0.0f;
+    float deceleration = (float)stepper->accel_points[0].acceleration;
+
+    for(int i = 0; i < stepper->accel_point_count; i++)
+    {
+        stepper_accel_point_t* point = &stepper->accel_points[i];
+
+        distance += ((float)point->speed * point->speed - speed * speed) / (2.0f * deceleration);
+        point->stop_distance = distance;
+        point->deceleration = (float)point->acceleration;
+        if( i + 1 < stepper->accel_point_count && stepper->accel_points[i + 1].acceleration < point->acceleration )
         {
-            // Estop is not active, enable stepper motor if it was previously enabled
-            gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL ^ 1 );
-            return false;
+            point->deceleration = (float)stepper->accel_points[i + 1].acceleration;
         }
+        speed = (float)point->speed;
+        deceleration = point->deceleration;
     }
 }
 
-bool process_stepper_enabled_led(stepper_state_t* stepper)
+/*!
+ * @brief Acceleration from the table at the current speed
+ *
+ * @param stepper: pointer to stepper state structure with at least one table point
+ * @return: acceleration in steps/s^2
+ */
+static float stepper_table_acceleration(const stepper_state_t* stepper)
 {
-    if( stepper == NULL )
+    const stepper_accel_point_t* points = stepper->accel_points;
+    float speed = stepper->velocity;
+
+    if( speed <= points[0].speed )
     {
-        return false;
+        return (float)points[0].acceleration;
     }
 
-    // Set moving LED based on stepper moving status
-    if(stepper->enabled)
+    for(int i = 0; i + 1 < stepper->accel_point_count; i++)
     {
-        gpio_put(STEPPER_ENABLE_LED_PIN, STEPPER_ENABLE_LED_PIN_ACTIVE_LEVEL);
+        if( speed < points[i + 1].speed )
+        {
+            return points[i].acceleration + (points[i + 1].acceleration - points[i].acceleration) *
+                   (speed - points[i].speed) / (points[i + 1].speed - points[i].speed);
+        }
     }
-    else
+    return (float)points[stepper->accel_point_count - 1].acceleration;
+}
+
+/*!
+ * @brief Table segment containing a speed, or a stop distance
+ *
+ * @param stepper: pointer to stepper state structure with at least one table point
+ * @param value: speed in steps/s, or stop distance in steps if by_distance is set
+ * @param by_distance: search by stop distance instead of speed
+ * @param base_speed: returns the speed at the start of the segment
+ * @param base_distance: returns the stop distance at the start of the segment
+ * @return: braking deceleration within the segment in steps/s^2
+ */
+static float stepper_table_segment(const stepper_state_t* stepper, float value, bool by_distance,
+                                   float* base_speed, float* base_distance)
+{
+    float deceleration = (float)stepper->accel_points[0].acceleration;
+
+    *base_speed = 0.0f;
+    *base_distance = 0.0f;
+    for(int i = 0; i < stepper->accel_point_count; i++)
     {
-        gpio_put(STEPPER_ENABLE_LED_PIN, STEPPER_ENABLE_LED_PIN_ACTIVE_LEVEL ^ 1);
+        const stepper_accel_point_t* point = &stepper->accel_points[i];
+        if( value < (by_distance ? point->stop_distance : point->speed) )
+        {
+            break;
+        }
+        *base_speed = (float)point->speed;
+        *base_distance = point->stop_distance;
+        deceleration = point->deceleration;
     }
-    return true;
-}   
-
-/* -------------------------- stepper movement processing function -----------------------------*/
+    return deceleration;
+}
 
-bool process_stepper_movement(stepper_state_t* stepper)
+/*!
+ * @brief Cruise speed from the step period and feed override
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: cruise speed in steps/s
+ */
+static float stepper_cruise_speed(const stepper_state_t* stepper)
 {
-    static bool function_initialized = false;
-    static int step_timer = 0;
-    int direction;
+    float speed = 1.0f / (stepper->step_period * STEPPER_TICK_S) * stepper->feed_override / 100.0f;
+    return (speed < STEPPER_MAX_SPEED) ? speed : STEPPER_MAX_SPEED;
+}
 
-    if(!function_initialized)
+/*!
+ * @brief Acceleration for speeding up at the current speed
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: acceleration in steps/s^2
+ */
+static float stepper_ramp_acceleration(const stepper_state_t* stepper)
+{
+    if( stepper->accel_point_count == 0 || stepper->estop_stopping )
     {
-        // Initialise GPIO pins for stepper control
-        gpio_init(STEPPER_STEP_PIN);
-        gpio_set_dir(STEPPER_STEP_PIN, GPIO_OUT);
-        gpio_init(STEPPER_DIR_PIN);
-        gpio_set_dir(STEPPER_DIR_PIN, GPIO_OUT);
-        gpio_put(STEPPER_STEP_PIN, 0);
-        gpio_put(STEPPER_DIR_PIN, 0);
-
-        // Mark as initialized
-        function_initialized = true;
+        return (float)stepper->acceleration;
     }
+    return stepper_table_acceleration(stepper);
+}
 
-    if( stepper == NULL )
+/*!
+ * @brief Deceleration for slowing down at the current speed
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: deceleration in steps/s^2
+ */
+static float stepper_ramp_deceleration(const stepper_state_t* stepper)
+{
+    float base_speed;
+    float base_distance;
+
+    if( stepper->estop_stopping )
     {
-        return false;
+        return (float)stepper->estop_deceleration;
+    }
+    if( stepper->accel_point_count == 0 )
+    {
+        return (float)stepper->deceleration;
     }
+    return stepper_table_segment(stepper, stepper->velocity, false, &base_speed, &base_distance);
+}
+
+/*!
+ * @brief Steps needed to brake to a stop from a speed
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param speed: speed in steps/s
+ * @return: stop distance in steps
+ */
+static float stepper_stop_distance(const stepper_state_t* stepper, float speed)
+{
+    float base_speed;
+    float base_distance;
+    float deceleration;
 
-    // Determine direction
-    if( stepper->target_position > stepper->current_position)
+    if( stepper->estop_stopping || stepper->accel_point_count == 0 )
     {
-        direction = STEPPER_DIRECTION_FORWARD; // Forward
+        deceleration = (float)(stepper->estop_stopping ? stepper->estop_deceleration : stepper->deceleration);
+        return speed * speed / (2.0f * deceleration);
     }
-    else
+    deceleration = stepper_table_segment(stepper, speed, false, &base_speed, &base_distance);
+    return base_distance + (speed * speed - base_speed * base_speed) / (2.0f * deceleration);
+}
+
+/*!
+ * @brief Highest speed that can still brake to an end speed within a distance
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param end_speed: speed to be reached in steps/s
+ * @param distance: steps available to brake
+ * @return: speed in steps/s
+ */
+static float stepper_braking_speed(const stepper_state_t* stepper, float end_speed, float distance)
+{
+    float base_speed;
+    float base_distance;
+    float deceleration;
+
+    if( stepper->estop_stopping || stepper->accel_point_count == 0 )
     {
-        direction = STEPPER_DIRECTION_BACKWARD; // Backward
+        deceleration = (float)(stepper->estop_stopping ? stepper->estop_deceleration : stepper->deceleration);
+        return sqrtf(end_speed * end_speed + 2.0f * deceleration * distance);
     }
+    distance += stepper_stop_distance(stepper, end_speed);
+    deceleration = stepper_table_segment(stepper, distance, true, &base_speed, &base_distance);
+    return sqrtf(base_speed * base_speed + 2.0f * deceleration * (distance - base_distance));
+}
 
-    // Set direction pin
-    gpio_put(STEPPER_DIR_PIN, direction);
+bool stepper_set_accel_point(stepper_state_t* stepper, int index, int speed, int acceleration)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
 
-    // Check if we are moving
-    if( stepper->moving )
+    if( index < 0 || index >= STEPPER_MAX_ACCEL_POINTS || index > stepper->accel_point_count )
     {
-        // Increment step timer
-        step_timer++;
+        return false;
+    }
 
-        if( step_timer == stepper->step_period/2 )
+    if( acceleration != 0 )
+    {
+        if( acceleration < STEPPER_MIN_ACCELERATION || acceleration > STEPPER_MAX_ACCELERATION )
         {
-            // set step pin high
-            gpio_put(STEPPER_STEP_PIN, 1);
+            return false;
         }
-        else if( step_timer >= stepper->step_period )
-        {
-            // set step pin low
-            gpio_put(STEPPER_STEP_PIN, 0);
-            step_timer = 0;
 
-            // Update current position
-            if( direction == STEPPER_DIRECTION_FORWARD )
-            {
-                stepper->current_position++;
-            }
-            else
-            {
-                stepper->current_position--;
-            }
-            // Check if we have reached the target position
-            if( stepper->current_position == stepper->target_position )
-            {
-                stepper->moving = false;
-                //printf("\nStepper reached target position: %d\n", stepper->current_position);
-            }
+        // Keep the points in increasing speed order
+        if( speed < 0 || speed > STEPPER_MAX_SPEED ||
+            (index > 0 && speed <= stepper->accel_points[index - 1].speed) ||
+            (index + 1 < stepper->accel_point_count && speed >= stepper->accel_points[index + 1].speed) )
+        {
+            return false;
         }
     }
+
+    stepper_write_begin(stepper);
+    if( acceleration == 0 )
+    {
+        stepper->accel_point_count = index;
+    }
     else
     {
-        // Ensure step pin is low when not moving
-        gpio_put(STEPPER_STEP_PIN, 0);
-        step_timer = 0;
+        stepper->accel_points[index].speed = speed;
+        stepper->accel_points[index].acceleration = acceleration;
+        if( index == stepper->accel_point_count )
+        {
+            stepper->accel_point_count++;
+        }
+    }
+    stepper_update_accel_table(stepper);
+    stepper->profile_version++;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_set_gearing(stepper_state_t* stepper, bool enable, int numerator, int denominator, int32_t count)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( enable && (numerator == 0 || numerator < -STEPPER_MAX_GEAR_RATIO || numerator > STEPPER_MAX_GEAR_RATIO ||
+                   denominator < 1 || denominator > STEPPER_MAX_GEAR_RATIO || stepper->estop_stopping) )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->gear_enabled = enable;
+    if( enable )
+    {
+        stepper->gear_numerator = numerator;
+        stepper->gear_denominator = denominator;
+        stepper->gear_origin_count = count;
+        stepper->gear_origin_position = stepper->current_position;
+        stepper->gear_speed = 0.0f;
+        stepper->gear_speed_ticks = 0;
+        stepper->gear_speed_start = stepper->current_position;
+        stepper->approach_pending = false;
+        stepper->track_enabled = false;
     }
-    return stepper->moving;    
+    stepper_write_end(stepper);
+    return true;
+}
+
+/*!
+ * @brief Goal of the tracking filter, moving from its origin to the latest setpoint
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param velocity: returns the goal speed in steps/s, positive forward
+ * @return: goal in steps from track_origin
+ */
+static float stepper_track_goal(const stepper_state_t* stepper, float* velocity)
+{
+    int distance = stepper->track_setpoint - stepper->track_origin;
+
+    if( stepper->track_ticks >= stepper->track_interval )
+    {
+        *velocity = 0.0f;
+        return (float)distance;
+    }
+    *velocity = distance / (stepper->track_interval * STEPPER_TICK_S);
+    return distance * (float)stepper->track_ticks / (float)stepper->track_interval;
+}
+
+bool stepper_set_tracking(stepper_state_t* stepper, bool enable)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( enable && stepper->estop_stopping )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    if( enable )
+    {
+        // Carry on to the current target, from the current position and velocity
+        stepper->track_setpoint = stepper->approach_pending ? stepper->approach_target : stepper->target_position;
+        stepper->track_origin = stepper->track_setpoint;
+        stepper->track_ticks = STEPPER_TRACK_MAX_INTERVAL_TICKS + 1;
+        stepper->track_interval = 1;
+        stepper->track_position = stepper->current_position;
+        stepper->track_fraction = 0.0f;
+        stepper->track_velocity = (stepper->direction == STEPPER_DIRECTION_FORWARD) ? stepper->velocity : -stepper->velocity;
+        stepper->track_setpoints = 0;
+        stepper->target_position = stepper->current_position;
+        stepper->approach_pending = false;
+        stepper->gear_enabled = false;
+        stepper->track_enabled = true;
+    }
+    else if( stepper->track_enabled )
+    {
+        // Finish as an ordinary move to the latest setpoint
+        stepper->track_enabled = false;
+        stepper->plan_retarget = stepper->moving && stepper->velocity != 0.0f;
+        stepper->target_position = stepper->track_setpoint;
+        stepper->moving = true;
+    }
+    stepper->plan_index = STEPPER_NO_PLAN;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_track_setpoint(stepper_state_t* stepper, int setpoint)
+{
+    float velocity;
+    int goal;
+
+    if( stepper == NULL || !stepper->track_enabled )
+    {
+        return false;
+    }
+
+    if( setpoint < MIN_STEPPER_POSITION || setpoint > MAX_STEPPER_POSITION )
+    {
+        return false;
+    }
+
+    // The goal moves on from where it is to the new setpoint over the time the last one took,
+    // so a regular stream is followed at its own speed rather than stepped to
+    goal = stepper->track_origin + (int)lroundf(stepper_track_goal(stepper, &velocity));
+
+    stepper_write_begin(stepper);
+    stepper->track_origin = goal;
+    stepper->track_setpoint = setpoint;
+    stepper->track_interval = (stepper->track_ticks <= STEPPER_TRACK_MAX_INTERVAL_TICKS && stepper->track_ticks > 0) ? stepper->track_ticks : 1;
+    stepper->track_ticks = 0;
+    stepper->track_setpoints++;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_set_trigger(stepper_state_t* stepper, int index, int position, int pin, int pulse_us, int direction)
+{
+    stepper_trigger_t* trigger;
+    int count = 0;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( index < 0 || index >= STEPPER_MAX_TRIGGERS )
+    {
+        return false;
+    }
+
+    if( pin != STEPPER_TRIGGER_UNUSED )
+    {
+        if( position < MIN_STEPPER_POSITION || position > MAX_STEPPER_POSITION )
+        {
+            return false;
+        }
+
+        // Never take over a pin the stepper or the board already uses
+        if( pin < 0 || pin > STEPPER_MAX_TRIGGER_PIN ||
+            (pin >= STEPPER_BOARD_PIN_FIRST && pin <= STEPPER_BOARD_PIN_LAST) ||
+            pin == STEPPER_STEP_PIN || pin == STEPPER_DIR_PIN || pin == STEPPER_ENABLE_PIN ||
+            pin == STEPPER_ENABLE_LED_PIN || pin == STEPPER_ESTOP_LED_PIN || pin == STEPPER_ESTOP_PIN )
+        {
+            return false;
+        }
+
+        if( pulse_us < TIMER_INTERVAL_US || pulse_us > STEPPER_MAX_TRIGGER_PULSE_US )
+        {
+            return false;
+        }
+
+        if( direction != STEPPER_DIRECTION_FORWARD && direction != STEPPER_DIRECTION_BACKWARD &&
+            direction != STEPPER_TRIGGER_BOTH )
+        {
+            return false;
+        }
+    }
+
+    trigger = &stepper->triggers[index];
+    stepper_write_begin(stepper);
+
+    // End any pulse in progress on the old pin
+    if( trigger->ticks_left > 0 )
+    {
+        gpio_put(trigger->pin, STEPPER_TRIGGER_ACTIVE_LEVEL ^ 1);
+        trigger->ticks_left = 0;
+        stepper->trigger_pulses--;
+    }
+
+    trigger->pin = pin;
+    if( pin != STEPPER_TRIGGER_UNUSED )
+    {
+        trigger->position = position;
+        trigger->pulse_ticks = pulse_us / TIMER_INTERVAL_US;
+        trigger->direction = direction;
+        trigger->fire_count = 0;
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_OUT);
+        gpio_put(pin, STEPPER_TRIGGER_ACTIVE_LEVEL ^ 1);
+    }
+
+    // Triggers in use are checked on every step, keep the count so an empty table costs nothing
+    for(int i = 0; i < STEPPER_MAX_TRIGGERS; i++)
+    {
+        if(stepper->triggers[i].pin != STEPPER_TRIGGER_UNUSED)
+        {
+            count = i + 1;
+        }
+    }
+    stepper->trigger_count = count;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_set_feed_override(stepper_state_t* stepper, int percent)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( percent < STEPPER_MIN_FEED_OVERRIDE || percent > STEPPER_MAX_FEED_OVERRIDE )
+    {
+        return false;
+    }
+
+    // The step engine ramps to the new speed at the configured acceleration
+    stepper_write_begin(stepper);
+    stepper->feed_override = percent;
+    stepper->profile_version++;
+    stepper_write_end(stepper);
+    return true;
+}
+
+bool stepper_stop(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->target_position = stepper->current_position;
+    stepper->approach_pending = false;
+    stepper->gear_enabled = false;
+    stepper->track_enabled = false;
+    stepper->moving = false;
+    stepper->velocity = 0.0f;
+    stepper->step_phase = 0.0f;
+    stepper_write_end(stepper);
+    return true;
+}
+
+/*!
+ * @brief Move the target to where the stepper can brake to a stop
+ *
+ * @note: Brakes at the estop deceleration while estop_stopping is set. The stop position
+ *        replaces the target even when the target is nearer, so the stepper never
+ *        overshoots and reverses back to it.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: none
+ */
+static void stepper_brake_to_stop(stepper_state_t* stepper)
+{
+    int stopping_steps;
+    int backlash_remaining;
+    int stop_position;
+
+    // Backlash still to cross in the direction of travel takes steps without moving the carriage
+    if( stepper->direction == STEPPER_DIRECTION_FORWARD )
+    {
+        backlash_remaining = stepper->backlash_steps - stepper->backlash_slack;
+    }
+    else
+    {
+        backlash_remaining = stepper->backlash_slack;
+    }
+
+    // Positions travelled while braking from the current speed
+    stopping_steps = (int)ceilf(stepper_stop_distance(stepper, stepper->velocity)) - backlash_remaining;
+    if( stopping_steps < 0 )
+    {
+        stopping_steps = 0;
+    }
+
+    // Stop there even if the old target is nearer, braking for it would overshoot and come back
+    if( stepper->direction == STEPPER_DIRECTION_FORWARD )
+    {
+        stop_position = stepper->current_position + stopping_steps;
+    }
+    else
+    {
+        stop_position = stepper->current_position - stopping_steps;
+    }
+
+    if( stop_position < MIN_STEPPER_POSITION )
+    {
+        stop_position = MIN_STEPPER_POSITION;
+    }
+    else if( stop_position > MAX_STEPPER_POSITION )
+    {
+        stop_position = MAX_STEPPER_POSITION;
+    }
+
+    stepper_write_begin(stepper);
+    stepper->target_position = stop_position;
+    stepper->plan_retarget = true;
+    stepper->approach_pending = false;
+    stepper->gear_enabled = false;
+    stepper->track_enabled = false;
+    stepper_write_end(stepper);
+}
+
+bool stepper_stop_decelerate(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if( !stepper->moving )
+    {
+        return stepper_stop(stepper);
+    }
+
+    // An estop stop is already braking harder
+    if( !stepper->estop_stopping )
+    {
+        stepper_brake_to_stop(stepper);
+    }
+    return true;
+}
+
+bool stepper_enable(stepper_state_t* stepper, bool enable)
+{
+    static bool gpio_initialized = false;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // A batch is validated on a scratch copy, only the state changes
+    if( !stepper->validate_only )
+    {
+        if(!gpio_initialized)
+        {
+            gpio_init(STEPPER_ENABLE_PIN);
+            gpio_set_dir(STEPPER_ENABLE_PIN, GPIO_OUT);
+            gpio_initialized = true;
+        }
+
+        gpio_put(STEPPER_ENABLE_PIN, enable ? (1 ^ STEPPER_ENABLE_PIN_INVERTED) : (0 ^ STEPPER_ENABLE_PIN_INVERTED)); // Enable or disable the stepper motor
+    }
+
+    stepper_write_begin(stepper);
+    stepper->enabled = enable;
+    // A disabled stepper stops following the external axis and the setpoints
+    if( !enable )
+    {
+        stepper->gear_enabled = false;
+        stepper->track_enabled = false;
+    }
+    stepper_write_end(stepper);
+    return true;
+}
+
+stepper_state_t* stepper_scratch_copy(const stepper_state_t* stepper)
+{
+    static stepper_state_t scratch;
+
+    scratch = *stepper;
+    scratch.validate_only = true;
+    return &scratch;
+}
+
+
+
+bool stepper_is_estop_active(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Read estop input pin
+    if(gpio_get(STEPPER_ESTOP_PIN) == STEPPER_ESTOP_ACTIVE_LEVEL)
+    {
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool process_stepper_estop(stepper_state_t* stepper)
+{
+    static int extop_active_count = 0;
+    static int estop_stop_elapsed_ms = 0;
+    bool estop_input;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Read estop input pin
+    estop_input = (gpio_get(STEPPER_ESTOP_PIN) == STEPPER_ESTOP_ACTIVE_LEVEL);
+
+    // Category 1 estop, brake with holding torque on a moving stepper first
+    if(estop_input && !stepper->estop_stopping && stepper->estop_mode == STEPPER_ESTOP_MODE_DECEL &&
+       stepper->moving && stepper->enabled)
+    {
+        stepper_write_begin(stepper);
+        stepper->estop_stopping = true;
+        stepper_write_end(stepper);
+        stepper_brake_to_stop(stepper);
+        estop_stop_elapsed_ms = 0;
+        EVENT_LOG("Estop braking from %d steps/s at %d", (int)stepper->velocity, stepper->current_position);
+    }
+
+    // Keep braking, even if the estop is released, until stopped or out of time
+    if(stepper->estop_stopping)
+    {
+        estop_stop_elapsed_ms++;
+        gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL);
+        extop_active_count = STEPPER_ESTOP_DEACTIVATE_DELAY_MS;
+        if(stepper->moving && estop_stop_elapsed_ms < STEPPER_ESTOP_STOP_TIMEOUT_MS)
+        {
+            return true;
+        }
+        stepper_write_begin(stepper);
+        stepper->estop_stopping = false;
+        stepper_write_end(stepper);
+        estop_input = true; // De-energise below as for an instant estop
+    }
+
+    if(estop_input)
+    {
+        // Estop is active, disable stepper motor
+        if(stepper->enabled)
+        {
+            EVENT_LOG("Estop de-energised at %d", stepper->current_position);
+        }
+        stepper_enable(stepper, false);
+        gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL);
+        stepper_write_begin(stepper);
+        stepper->moving = false; // Stop any movement
+        stepper->velocity = 0.0f;
+        stepper->step_phase = 0.0f;
+        stepper->target_position = stepper->current_position; // Set target to current position
+        stepper->approach_pending = false;
+        stepper->gear_enabled = false;
+        stepper->track_enabled = false;
+        stepper_write_end(stepper);
+        extop_active_count = STEPPER_ESTOP_DEACTIVATE_DELAY_MS; // Reset deactivate delay counter
+        return true;
+    }
+    else
+    {
+        // Decrement estop deactivate delay counter
+        if(extop_active_count > 0)
+        {
+            extop_active_count--;
+            // Keep estop active until delay expires
+            gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL);
+            return true;
+        }
+        else
+        {
+            // Estop is not active, enable stepper motor if it was previously enabled
+            gpio_put(STEPPER_ESTOP_LED_PIN, STEPPER_ESTOP_LED_PIN_ACTIVE_LEVEL ^ 1 );
+            return false;
+        }
+    }
+}
+
+bool process_stepper_enabled_led(stepper_state_t* stepper)
+{
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    // Set moving LED based on stepper moving status
+    if(stepper->enabled)
+    {
+        gpio_put(STEPPER_ENABLE_LED_PIN, STEPPER_ENABLE_LED_PIN_ACTIVE_LEVEL);
+    }
+    else
+    {
+        gpio_put(STEPPER_ENABLE_LED_PIN, STEPPER_ENABLE_LED_PIN_ACTIVE_LEVEL ^ 1);
+    }
+    return true;
+}   
+
+/* -------------------------- electronic gearing -----------------------------*/
+/* Note: The target is the position at engagement plus the external steps since  */
+/* then scaled by the ratio, so rounding never accumulates over a long run. The   */
+/* target speed is measured too, the step engine brakes to it rather than to a    */
+/* stop so the stepper runs with the external axis instead of chasing it.          */
+/* ------------------------------------------------------------------------------*/
+bool process_stepper_gearing(stepper_state_t* stepper, int32_t count)
+{
+    int64_t target;
+
+    if( stepper == NULL || !stepper->gear_enabled )
+    {
+        return false;
+    }
+
+    target = stepper->gear_origin_position +
+             (int64_t)(int32_t)((uint32_t)count - (uint32_t)stepper->gear_origin_count) * stepper->gear_numerator / stepper->gear_denominator;
+    if( target < MIN_STEPPER_POSITION )
+    {
+        target = MIN_STEPPER_POSITION;
+    }
+    else if( target > MAX_STEPPER_POSITION )
+    {
+        target = MAX_STEPPER_POSITION;
+    }
+
+    stepper_write_begin(stepper);
+    if( target != stepper->target_position )
+    {
+        stepper->target_position = (int)target;
+        stepper->moving = true;
+    }
+
+    // Measure the target speed over a fixed window
+    stepper->gear_speed_ticks++;
+    if( stepper->gear_speed_ticks >= STEPPER_GEAR_SPEED_TICKS )
+    {
+        stepper->gear_speed = (stepper->target_position - stepper->gear_speed_start) / (STEPPER_GEAR_SPEED_TICKS * STEPPER_TICK_S);
+        stepper->gear_speed_start = stepper->target_position;
+        stepper->gear_speed_ticks = 0;
+    }
+    stepper_write_end(stepper);
+    return true;
+}
+
+/* -------------------------- setpoint tracking -----------------------------*/
+/* Note: Each setpoint moves the goal on from where it is to the setpoint over the  */
+/* interval since the previous setpoint, interpolating a regular stream. The      */
+/* filtered setpoint runs at the goal speed plus the speed that brakes it onto    */
+/* the goal at the deceleration, at no more than the cruise speed, speeding up at */
+/* the acceleration. The target is its nearest whole step and its speed is fed    */
+/* forward like the gearing speed, so the step engine runs with it. It is kept as */
+/* whole steps plus a fraction so slow speeds are not lost to float rounding.     */
+/* ---------------------------------------------------------------------------------*/
+bool process_stepper_tracking(stepper_state_t* stepper)
+{
+    float goal_velocity;
+    float error;
+    float cruise_speed;
+    float desired_velocity;
+    float velocity;
+    float change;
+    int target;
+
+    if( stepper == NULL || !stepper->track_enabled )
+    {
+        return false;
+    }
+
+    stepper_write_begin(stepper);
+    if( stepper->track_ticks <= STEPPER_TRACK_MAX_INTERVAL_TICKS )
+    {
+        stepper->track_ticks++;
+    }
+    velocity = stepper->track_velocity;
+
+    // Goal speed plus the speed that still brakes onto the goal
+    error = (float)(stepper->track_origin - stepper->track_position) - stepper->track_fraction +
+            stepper_track_goal(stepper, &goal_velocity);
+    desired_velocity = stepper_braking_speed(stepper, 0.0f, fabsf(error));
+    desired_velocity = goal_velocity + ((error >= 0.0f) ? desired_velocity : -desired_velocity);
+    cruise_speed = stepper_cruise_speed(stepper);
+    if( desired_velocity > cruise_speed )
+    {
+        desired_velocity = cruise_speed;
+    }
+    else if( desired_velocity < -cruise_speed )
+    {
+        desired_velocity = -cruise_speed;
+    }
+
+    // Speed up at the acceleration, slow down or turn round at the deceleration
+    if( (desired_velocity >= 0.0f) == (velocity >= 0.0f) && fabsf(desired_velocity) > fabsf(velocity) )
+    {
+        change = stepper_ramp_acceleration(stepper) * STEPPER_TICK_S;
+    }
+    else
+    {
+        change = stepper_ramp_deceleration(stepper) * STEPPER_TICK_S;
+    }
+    if( desired_velocity > velocity + change )
+    {
+        velocity += change;
+    }
+    else if( desired_velocity < velocity - change )
+    {
+        velocity -= change;
+    }
+    else
+    {
+        velocity = desired_velocity;
+    }
+
+    // Settle on a still goal once this tick would reach it at a speed that stops in a tick or two
+    if( goal_velocity == 0.0f && fabsf(error) <= fabsf(velocity) * STEPPER_TICK_S && fabsf(velocity) <= 2.0f * change )
+    {
+        stepper->track_position = stepper->track_setpoint;
+        stepper->track_fraction = 0.0f;
+        velocity = 0.0f;
+    }
+    else
+    {
+        stepper->track_fraction += velocity * STEPPER_TICK_S;
+        if( stepper->track_fraction >= 1.0f )
+        {
+            stepper->track_position++;
+            stepper->track_fraction -= 1.0f;
+        }
+        else if( stepper->track_fraction < 0.0f )
+        {
+            stepper->track_position--;
+            stepper->track_fraction += 1.0f;
+        }
+    }
+    stepper->track_velocity = velocity;
+
+    target = stepper->track_position + ((stepper->track_fraction >= 0.5f) ? 1 : 0);
+    if( target < MIN_STEPPER_POSITION )
+    {
+        target = MIN_STEPPER_POSITION;
+    }
+    else if( target > MAX_STEPPER_POSITION )
+    {
+        target = MAX_STEPPER_POSITION;
+    }
+
+    if( target != stepper->target_position )
+    {
+        stepper->target_position = target;
+        stepper->moving = true;
+    }
+    stepper_write_end(stepper);
+    return true;
+}
+
+/* -------------------------- stepper movement processing function -----------------------------*/
+/* Note: Each tick the speed ramps towards the cruise speed by at most acceleration * tick     */
+/* when speeding up and deceleration * tick when slowing, capped by the braking speed         */
+/* sqrt(2 * d * s) that stops the stepper at deceleration d in the s steps left, including    */
+/* any backlash still to cross. Backlash steps turn the motor but not current_position.        */
+/* Speed zones cap the speed inside them and, ahead of the stepper, by sqrt(z^2 + 2 * d * s)   */
+/* so it has already slowed to the zone limit z on reaching the zone s steps away.             */
+/* With an acceleration table, a and d follow the current speed and the braking speeds come    */
+/* from the tabulated stop distances instead of a single d.                                    */
+/* A move plan, made on the first tick of a move or taken from the plan cache for a repeated  */
+/* move, marks where the braking checks can first matter so the cruise skips them.            */
+/* The phase accumulator advances by speed * tick and a one tick step pulse is issued each     */
+/* time it passes a whole step, so any speed up to the MIN_STEPPER_PERIOD rate can be run.     */
+/* ---------------------------------------------------------------------------------------------*/
+
+/*!
+ * @brief Speed limit from the speed zones at and ahead of the stepper
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: speed limit in steps/s
+ */
+static float stepper_zone_speed(const stepper_state_t* stepper)
+{
+    float limit = STEPPER_MAX_SPEED;
+
+    for(int i = 0; i < stepper->speed_zone_count; i++)
+    {
+        const stepper_speed_zone_t* zone = &stepper->speed_zones[i];
+        float zone_speed;
+        int distance;
+
+        if( zone->max_speed == 0 )
+        {
+            continue;
+        }
+
+        // Steps before the first step into the zone, negative if behind the stepper
+        if( stepper->current_position >= zone->start && stepper->current_position <= zone->end )
+        {
+            distance = 0;
+        }
+        else if( stepper->direction == STEPPER_DIRECTION_FORWARD )
+        {
+            distance = zone->start - stepper->current_position - 1;
+        }
+        else
+        {
+            distance = stepper->current_position - zone->end - 1;
+        }
+
+        if( distance < 0 )
+        {
+            continue;
+        }
+
+        zone_speed = (float)zone->max_speed;
+        if( distance > 0 )
+        {
+            zone_speed = stepper_braking_speed(stepper, zone_speed, (float)distance);
+        }
+        if( zone_speed < limit )
+        {
+            limit = zone_speed;
+        }
+    }
+    return limit;
+}
+
+/*!
+ * @brief Find or make the plan for the move to the current target
+ *
+ * @note: Plans from the current position, so only call once the target is ahead. A move
+ *        retargeted or stopped while moving starts from a position that will not come round
+ *        again, so its plans, including the one after any reversal, go in the retarget entry
+ *        and do not evict a cached plan.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: pointer to the plan, also recorded in plan_index
+ */
+static const stepper_plan_t* stepper_plan_move(stepper_state_t* stepper)
+{
+    stepper_plan_t* plan = &stepper->plan_cache[0];
+    int start = stepper->current_position;
+    int target = stepper->target_position;
+    int sign = (target > start) ? 1 : -1;
+    float cruise_speed;
+    float cruise_distance;
+    int cruise_until;
+
+    stepper->plan_clock++;
+
+    // Reuse a plan for the same move, else replace the least recently used entry
+    for(int i = 0; i < STEPPER_PLAN_CACHE_SIZE && stepper->velocity == 0.0f && !stepper->plan_retarget; i++)
+    {
+        stepper_plan_t* entry = &stepper->plan_cache[i];
+        if( entry->last_used != 0 && entry->start == start && entry->target == target &&
+            entry->version == stepper->profile_version )
+        {
+            entry->last_used = stepper->plan_clock;
+            stepper->plan_index = i;
+            stepper->plan_hits++;
+            return entry;
+        }
+        if( entry->last_used < plan->last_used )
+        {
+            plan = entry;
+        }
+    }
+
+    // Brake for the target from cruise speed, with a step spare for the step in progress
+    cruise_speed = stepper_cruise_speed(stepper);
+    cruise_distance = stepper_stop_distance(stepper, cruise_speed);
+    cruise_until = target - sign * ((int)ceilf(cruise_distance) + 2);
+
+    // Slow for any zone ahead below cruise speed, none of the move cruises inside a zone
+    for(int i = 0; i < stepper->speed_zone_count; i++)
+    {
+        const stepper_speed_zone_t* zone = &stepper->speed_zones[i];
+        int entry_position = (sign > 0) ? zone->start : zone->end;
+        int zone_until;
+
+        if( zone->max_speed == 0 || zone->max_speed >= cruise_speed )
+        {
+            continue;
+        }
+
+        if( start >= zone->start && start <= zone->end )
+        {
+            zone_until = start;
+        }
+        else if( (entry_position - start) * sign > 0 )
+        {
+            zone_until = entry_position - sign * ((int)ceilf(cruise_distance - stepper_stop_distance(stepper, (float)zone->max_speed)) + 2);
+        }
+        else
+        {
+            continue;
+        }
+
+        if( (zone_until - cruise_until) * sign < 0 )
+        {
+            cruise_until = zone_until;
+        }
+    }
+
+    if( stepper->velocity != 0.0f || stepper->plan_retarget )
+    {
+        plan = &stepper->plan_cache[STEPPER_RETARGET_PLAN];
+    }
+    else
+    {
+        stepper->plan_misses++;
+    }
+
+    plan->start = start;
+    plan->target = target;
+    plan->version = stepper->profile_version;
+    plan->cruise_until = cruise_until;
+    plan->cruise_speed = cruise_speed;
+    plan->last_used = stepper->plan_clock;
+    stepper->plan_index = plan - stepper->plan_cache;
+    return plan;
+}
+
+/*!
+ * @brief Start the pulse of each trigger on the position just stepped onto
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: none
+ */
+static void stepper_fire_triggers(stepper_state_t* stepper)
+{
+    for(int i = 0; i < stepper->trigger_count; i++)
+    {
+        stepper_trigger_t* trigger = &stepper->triggers[i];
+        if( trigger->pin != STEPPER_TRIGGER_UNUSED && trigger->position == stepper->current_position &&
+            (trigger->direction == STEPPER_TRIGGER_BOTH || trigger->direction == stepper->direction) )
+        {
+            gpio_put(trigger->pin, STEPPER_TRIGGER_ACTIVE_LEVEL);
+            if( trigger->ticks_left == 0 )
+            {
+                stepper->trigger_pulses++;
+            }
+            trigger->ticks_left = trigger->pulse_ticks;
+            trigger->fire_count++;
+        }
+    }
+}
+
+/*!
+ * @brief Count down the trigger pulses in progress and end those that are done
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: none
+ */
+static void stepper_end_trigger_pulses(stepper_state_t* stepper)
+{
+    for(int i = 0; i < stepper->trigger_count; i++)
+    {
+        stepper_trigger_t* trigger = &stepper->triggers[i];
+        if( trigger->ticks_left > 0 && --trigger->ticks_left == 0 )
+        {
+            gpio_put(trigger->pin, STEPPER_TRIGGER_ACTIVE_LEVEL ^ 1);
+            stepper->trigger_pulses--;
+        }
+    }
+}
+
+bool process_stepper_movement(stepper_state_t* stepper)
+{
+    static bool function_initialized = false;
+    int remaining;
+    int backlash_remaining;
+    bool cruising = false;
+    float follow_speed = 0.0f;
+    float desired_speed;
+    float speed_change;
+    float acceleration;
+    float deceleration;
+
+    if( stepper == NULL )
+    {
+        return false;
+    }
+
+    if(!function_initialized)
+    {
+        // Initialise GPIO pins for stepper control
+        gpio_init(STEPPER_STEP_PIN);
+        gpio_set_dir(STEPPER_STEP_PIN, GPIO_OUT);
+        gpio_init(STEPPER_DIR_PIN);
+        gpio_set_dir(STEPPER_DIR_PIN, GPIO_OUT);
+        gpio_put(STEPPER_STEP_PIN, 0);
+        gpio_put(STEPPER_DIR_PIN, stepper->direction);
+
+        // Mark as initialized
+        function_initialized = true;
+    }
+
+    stepper_write_begin(stepper);
+
+    // End the step pulse started on the previous tick
+    if( stepper->step_pin_high )
+    {
+        gpio_put(STEPPER_STEP_PIN, 0);
+        stepper->step_pin_high = false;
+    }
+
+    // Count down trigger pulses, they may outlast the move
+    if( stepper->trigger_pulses > 0 )
+    {
+        stepper_end_trigger_pulses(stepper);
+    }
+
+    // Check if we are moving
+    if( !stepper->moving )
+    {
+        stepper->velocity = 0.0f;
+        stepper->step_phase = 0.0f;
+        stepper_write_end(stepper);
+        return false;
+    }
+
+    acceleration = stepper_ramp_acceleration(stepper);
+    deceleration = stepper_ramp_deceleration(stepper);
+
+    // Steps left in the direction of travel, zero or negative if the target is behind
+    if( stepper->direction == STEPPER_DIRECTION_FORWARD )
+    {
+        remaining = stepper->target_position - stepper->current_position;
+    }
+    else
+    {
+        remaining = stepper->current_position - stepper->target_position;
+    }
+
+    // Once stopped with the target behind, reverse direction
+    if( remaining < 0 && stepper->velocity <= 0.0f )
+    {
+        stepper->direction ^= 1;
+        gpio_put(STEPPER_DIR_PIN, stepper->direction);
+        remaining = -remaining;
+    }
+
+    // Backlash still to cross in the direction of travel counts towards the steps left
+    if( stepper->direction == STEPPER_DIRECTION_FORWARD )
+    {
+        backlash_remaining = stepper->backlash_steps - stepper->backlash_slack;
+    }
+    else
+    {
+        backlash_remaining = stepper->backlash_slack;
+    }
+    if( remaining > 0 )
+    {
+        remaining += backlash_remaining;
+    }
+
+    // A geared or tracked target moving the same way only needs braking down to its speed
+    if( stepper->gear_enabled || stepper->track_enabled )
+    {
+        follow_speed = stepper->gear_enabled ? stepper->gear_speed : stepper->track_velocity;
+        if( stepper->direction != STEPPER_DIRECTION_FORWARD )
+        {
+            follow_speed = -follow_speed;
+        }
+        if( follow_speed < 0.0f )
+        {
+            follow_speed = 0.0f;
+        }
+    }
+
+    // Cruise speed, limited to the speed we can still brake from
+    desired_speed = stepper_cruise_speed(stepper);
+
+    // Until the move plan says braking may be needed, cruise without the braking checks,
+    // a geared or tracked target moves every few ticks so is not planned
+    if( remaining > 0 && !stepper->estop_stopping && !stepper->gear_enabled && !stepper->track_enabled )
+    {
+        const stepper_plan_t* plan;
+        if( stepper->plan_index == STEPPER_NO_PLAN ||
+            stepper->plan_cache[stepper->plan_index].target != stepper->target_position ||
+            stepper->plan_cache[stepper->plan_index].version != stepper->profile_version )
+        {
+            plan = stepper_plan_move(stepper);
+        }
+        else
+        {
+            plan = &stepper->plan_cache[stepper->plan_index];
+        }
+        cruising = stepper->velocity <= plan->cruise_speed &&
+                   ((stepper->direction == STEPPER_DIRECTION_FORWARD) ? (stepper->current_position < plan->cruise_until)
+                                                                      : (stepper->current_position > plan->cruise_until));
+    }
+
+    if( !cruising )
+    {
+        if( stepper->speed_zone_count > 0 )
+        {
+            float zone_speed = stepper_zone_speed(stepper);
+            if( zone_speed < desired_speed )
+            {
+                desired_speed = zone_speed;
+            }
+        }
+        if( remaining < 0 )
+        {
+            desired_speed = 0.0f;
+        }
+        else if( remaining == 0 )
+        {
+            if( follow_speed < desired_speed )
+            {
+                desired_speed = follow_speed;
+            }
+        }
+        else
+        {
+            // Part of the next step is already travelled, brake over what is left of it
+            float braking_speed = stepper_braking_speed(stepper, follow_speed, remaining - stepper->step_phase);
+            if( braking_speed < desired_speed )
+            {
+                desired_speed = braking_speed;
+            }
+        }
+    }
+
+    // Ramp the speed towards the desired speed
+    if( stepper->velocity < desired_speed )
+    {
+        speed_change = acceleration * STEPPER_TICK_S;
+        stepper->velocity += speed_change;
+        if( stepper->velocity > desired_speed )
+        {
+            stepper->velocity = desired_speed;
+        }
+    }
+    else
+    {
+        // Snap onto the desired speed once within two ticks of it, small speed changes lose
+        // precision at high speed and would otherwise leave the stepper above the braking curve
+        speed_change = deceleration * STEPPER_TICK_S;
+        if( stepper->velocity - 2.0f * speed_change < desired_speed )
+        {
+            stepper->velocity = desired_speed;
+        }
+        else
+        {
+            stepper->velocity -= speed_change;
+        }
+    }
+
+    // Advance the step phase and issue a step pulse on each whole step
+    stepper->step_phase += stepper->velocity * STEPPER_TICK_S;
+    if( stepper->step_phase >= 1.0f )
+    {
+        int next_position = stepper->current_position + ((stepper->direction == STEPPER_DIRECTION_FORWARD) ? 1 : -1);
+        stepper->step_phase -= 1.0f;
+
+        // Cross the backlash first, the carriage does not move
+        if( backlash_remaining > 0 )
+        {
+            gpio_put(STEPPER_STEP_PIN, 1);
+            stepper->step_pin_high = true;
+            stepper->backlash_slack += (stepper->direction == STEPPER_DIRECTION_FORWARD) ? 1 : -1;
+        }
+        // Never overrun the travel limits, even while braking past the target
+        else if( next_position < MIN_STEPPER_POSITION || next_position > MAX_STEPPER_POSITION )
+        {
+            stepper->velocity = 0.0f;
+            stepper->step_phase = 0.0f;
+            stepper->target_position = stepper->current_position;
+        }
+        else
+        {
+            gpio_put(STEPPER_STEP_PIN, 1);
+            stepper->step_pin_high = true;
+            stepper->current_position = next_position;
+            if( stepper->trigger_count > 0 )
+            {
+                stepper_fire_triggers(stepper);
+            }
+        }
+    }
+
+    // Check if we have reached the target position slowly enough to stop there
+    if( stepper->current_position == stepper->target_position &&
+        stepper->velocity * stepper->velocity <= 2.0f * deceleration * STEPPER_ARRIVAL_STEPS &&
+        stepper->approach_pending )
+    {
+        // Overshoot reached, turn round for the final approach
+        stepper->target_position = stepper->approach_target;
+        stepper->approach_pending = false;
+        stepper->velocity = 0.0f;
+        stepper->step_phase = 0.0f;
+    }
+    else if( stepper->current_position == stepper->target_position && follow_speed == 0.0f &&
+             stepper->velocity * stepper->velocity <= 2.0f * deceleration * STEPPER_ARRIVAL_STEPS )
+    {
+        stepper->moving = false;
+        stepper->velocity = 0.0f;
+        stepper->step_phase = 0.0f;
+        EVENT_LOG("Move done at %d", stepper->current_position);
+    }
+
+    stepper_write_end(stepper);
+    return stepper->moving;
 }
@@ -26,6 +26,11 @@
 #define STEPPER_ESTOP_PIN                   16      // GPIO pin for estop input (optional)
 #define STEPPER_ESTOP_ACTIVE_LEVEL          0       // Active level for estop input pin (0 = active low, 1 = active high)
 #define STEPPER_ESTOP_DEACTIVATE_DELAY_MS   100     // Number of consecutive checks for estop deactivation before re-enabling stepper
+#define STEPPER_ESTOP_MODE_INSTANT          0       // Estop de-energises the stepper immediately (category 0)
+#define STEPPER_ESTOP_MODE_DECEL            1       // Estop brakes at the estop deceleration, then de-energises (category 1)
+#define STEPPER_DEFAULT_ESTOP_MODE          STEPPER_ESTOP_MODE_INSTANT
+#define STEPPER_DEFAULT_ESTOP_DECELERATION  1000000 // Default estop deceleration in steps/s^2
+#define STEPPER_ESTOP_STOP_TIMEOUT_MS       50      // Hard bound on a category 1 stop, de-energised after this even if still moving
 #define STEPPER_DIRECTION_FORWARD           1
 #define STEPPER_DIRECTION_BACKWARD          0
 #define STEPPER_STEPS_PER_REV               3200    // Number of steps per revolution for the stepper motor
@@ -36,11 +41,106 @@
 #define MAX_STEPPER_POSITION                (STEPPER_STEPS_PER_REV * STEPPER_MAX_REVOLUTIONS)
 #define MIN_STEPPER_POSITION                0
 
+#define STEPPER_SNAPSHOT_RETRIES            16      // Attempts to read a consistent snapshot before giving up
+
+// Motion profile configuration
+#define STEPPER_TICK_S                      (TIMER_INTERVAL_US * 1e-6f) // Step engine tick in seconds
+#define STEPPER_DEFAULT_ACCELERATION        200000  // Default acceleration in steps/s^2
+#define STEPPER_DEFAULT_DECELERATION        200000  // Default deceleration in steps/s^2
+#define STEPPER_MIN_ACCELERATION            1000    // Minimum acceleration or deceleration in steps/s^2
+#define STEPPER_MAX_ACCELERATION            10000000 // Maximum acceleration or deceleration in steps/s^2
+#define STEPPER_ARRIVAL_STEPS               2       // Arrive at the target if slow enough to have stopped within this many steps
+#define STEPPER_DEFAULT_FEED_OVERRIDE       100     // Default feed rate override in percent
+#define STEPPER_MIN_FEED_OVERRIDE           1       // Minimum feed rate override in percent
+#define STEPPER_MAX_FEED_OVERRIDE           200     // Maximum feed rate override in percent, speed is still capped by MIN_STEPPER_PERIOD
+#define STEPPER_MAX_BACKLASH_STEPS          STEPPER_STEPS_PER_REV // Maximum backlash compensation in steps
+#define STEPPER_APPROACH_OFF                0       // Approach targets from either side
+#define STEPPER_APPROACH_FORWARD            1       // Always finish moves travelling forward
+#define STEPPER_APPROACH_BACKWARD           2       // Always finish moves travelling backward
+#define STEPPER_DEFAULT_APPROACH_STEPS      (STEPPER_STEPS_PER_REV / 16) // Default overshoot for a unidirectional approach
+#define STEPPER_MAX_SPEED_ZONES             4       // Number of position dependent speed limit zones
+#define STEPPER_MAX_SPEED                   (1.0f / (MIN_STEPPER_PERIOD * STEPPER_TICK_S)) // Highest step rate in steps/s
+#define STEPPER_MAX_ACCEL_POINTS            8       // Number of points in the speed dependent acceleration table
+#define STEPPER_PLAN_CACHE_SIZE             8       // Number of move plans kept for repeated moves
+#define STEPPER_NO_PLAN                     -1      // Plan index when the move has no plan
+#define STEPPER_RETARGET_PLAN               STEPPER_PLAN_CACHE_SIZE // Plan index of a move retargeted while moving, never cached
+#define STEPPER_MAX_GEAR_RATIO              1000    // Largest gearing numerator or denominator
+#define STEPPER_GEAR_SPEED_TICKS            500     // Ticks over which the geared target speed is measured (5 ms)
+#define STEPPER_TRACK_MAX_INTERVAL_TICKS    10000   // Longest setpoint interval interpolated over (100 ms), slower setpoints are stepped to
+#define STEPPER_MAX_TRIGGERS                8       // Number of position synchronised output triggers
+#define STEPPER_TRIGGER_UNUSED              -1      // Trigger pin of an unused trigger
+#define STEPPER_TRIGGER_BOTH                2       // Trigger fires travelling in either direction
+#define STEPPER_TRIGGER_ACTIVE_LEVEL        1       // Output level during a trigger pulse
+#define STEPPER_MAX_TRIGGER_PIN             28      // Highest GPIO pin usable as a trigger output, GP29 senses VSYS on Pico 2
+#define STEPPER_BOARD_PIN_FIRST             23      // First Pico 2 board pin never used as a trigger, GP23 SMPS mode
+#define STEPPER_BOARD_PIN_LAST              25      // Last Pico 2 board pin never used as a trigger, GP24 VBUS sense, GP25 LED
+#define STEPPER_MAX_TRIGGER_PULSE_US        1000000 // Longest trigger pulse in us
+
 #define STATUS_LED_ON                       1
 #define STATUS_LED_OFF                      0
 
+/*!
+ * @brief Position range with its own speed limit
+ *
+ * A zone with max_speed zero is unused.
+ */
+typedef struct stepper_speed_zone
+{
+    int start;            //!< First position in the zone in steps
+    int end;              //!< Last position in the zone in steps
+    int max_speed;        //!< Speed limit inside the zone in steps/s, 0 if unused
+} stepper_speed_zone_t;
+
+/*!
+ * @brief Point on the speed dependent acceleration table
+ *
+ * The stop distance and segment deceleration are derived when the table is set.
+ */
+typedef struct stepper_accel_point
+{
+    int speed;            //!< Speed of this point in steps/s
+    int acceleration;     //!< Acceleration available at this speed in steps/s^2
+    float stop_distance;  //!< Steps needed to brake to a stop from this speed
+    float deceleration;   //!< Braking deceleration from here to the next point in steps/s^2
+} stepper_accel_point_t;
+
+/*!
+ * @brief Move plan, the part of a move that can run at cruise speed
+ *
+ * Before cruise_until the stepper cannot need to brake for the target or a speed zone
+ * while at or below cruise_speed, so the step engine skips those checks. Plans are kept
+ * in a small least recently used cache keyed by start, target and profile version.
+ */
+typedef struct stepper_plan
+{
+    int start;            //!< Position the move was planned from
+    int target;           //!< Target of the move
+    uint32_t version;     //!< Profile version the plan was made with
+    int cruise_until;     //!< Braking checks start on reaching this position
+    float cruise_speed;   //!< Cruise speed the plan was made for in steps/s
+    uint32_t last_used;   //!< Plan clock at last use, 0 if the entry is empty
+} stepper_plan_t;
+
+/*!
+ * @brief Output pulse fired by the step engine when the stepper reaches a position
+ */
+typedef struct stepper_trigger
+{
+    int position;         //!< Position that fires the trigger
+    int pin;              //!< GPIO output pin, STEPPER_TRIGGER_UNUSED if unused
+    int pulse_ticks;      //!< Pulse length in TIMER_INTERVAL_US units
+    int direction;        //!< Fire travelling STEPPER_DIRECTION_FORWARD, STEPPER_DIRECTION_BACKWARD or STEPPER_TRIGGER_BOTH
+    int ticks_left;       //!< Ticks left of the pulse in progress, 0 if none
+    uint32_t fire_count;  //!< Number of times fired
+} stepper_trigger_t;
+
 /*!
  * @brief Structure to hold stepper motor state
+ *
+ * The state is owned by a single writer context (currently the superloop). Every update
+ * is bracketed by stepper_write_begin() and stepper_write_end() which maintain a seqlock
+ * sequence count, so readers in other contexts use stepper_get_snapshot() and never see
+ * a torn position/target pair, while the writer never has to take a lock.
  */
 typedef struct stepper_state
 {
@@ -49,8 +149,97 @@ typedef struct stepper_state
     int step_period;      //!< Step period in TIMMER_INTERVAL_US units
     bool moving;          //!< Is the stepper currently moving
     bool enabled;         //!< Is the stepper enabled
+    float velocity;       //!< Current speed in steps/s, always positive, in the direction of travel
+    int direction;        //!< Direction of travel, STEPPER_DIRECTION_FORWARD or STEPPER_DIRECTION_BACKWARD
+    int acceleration;     //!< Acceleration in steps/s^2
+    int deceleration;     //!< Deceleration in steps/s^2, used for braking to the target and stopping
+    int feed_override;    //!< Feed rate override applied to the step period speed in percent
+    int estop_mode;       //!< STEPPER_ESTOP_MODE_INSTANT or STEPPER_ESTOP_MODE_DECEL
+    int estop_deceleration; //!< Deceleration for a category 1 estop stop in steps/s^2
+    bool estop_stopping;  //!< Category 1 estop stop in progress, new targets are refused
+    int backlash_steps;   //!< Lead screw backlash in steps, taken up on each reversal
+    int backlash_slack;   //!< Motor position within the backlash, 0 at backward contact, backlash_steps at forward contact
+    int approach_mode;    //!< STEPPER_APPROACH_OFF, STEPPER_APPROACH_FORWARD or STEPPER_APPROACH_BACKWARD
+    int approach_steps;   //!< Overshoot before a unidirectional final approach in steps
+    int approach_target;  //!< Final target once the overshoot target is reached
+    bool approach_pending; //!< Moving to the overshoot target, approach_target follows
+    stepper_speed_zone_t speed_zones[STEPPER_MAX_SPEED_ZONES]; //!< Position dependent speed limits
+    int speed_zone_count; //!< Number of zones in use, zero skips the zone checks
+    stepper_accel_point_t accel_points[STEPPER_MAX_ACCEL_POINTS]; //!< Acceleration against speed, in increasing speed order
+    int accel_point_count; //!< Number of points in use, zero uses the fixed acceleration and deceleration
+    uint32_t profile_version; //!< Bumped on any change that affects braking, makes cached plans stale
+    stepper_plan_t plan_cache[STEPPER_PLAN_CACHE_SIZE + 1]; //!< Recently used move plans, then the retarget plan
+    int plan_index;       //!< Plan of the current move in plan_cache, or STEPPER_NO_PLAN
+    uint32_t plan_clock;  //!< Plan use counter for least recently used replacement
+    uint32_t plan_hits;   //!< Moves started from a cached plan
+    uint32_t plan_misses; //!< Moves that had to be planned
+    uint32_t plan_retargets; //!< Moves retargeted while moving
+    bool plan_retarget;   //!< Target changed while moving, the rest of the move is planned in the retarget entry
+    bool gear_enabled;    //!< Following the external axis, the target tracks its count
+    int gear_numerator;   //!< Stepper steps per gear_denominator external steps, negative to reverse
+    int gear_denominator; //!< External steps per gear_numerator stepper steps
+    int32_t gear_origin_count; //!< External count when gearing was engaged
+    int gear_origin_position; //!< Stepper position when gearing was engaged
+    float gear_speed;     //!< Measured speed of the geared target in steps/s, positive forward
+    int gear_speed_ticks; //!< Ticks into the current speed measurement
+    int gear_speed_start; //!< Geared target at the start of the current speed measurement
+    bool track_enabled;   //!< Following a stream of setpoints through the tracking filter
+    int track_setpoint;   //!< Latest setpoint in steps
+    int track_origin;     //!< Goal when the latest setpoint arrived, the goal moves from here to the setpoint
+    int track_ticks;      //!< Ticks since the latest setpoint, saturating above STEPPER_TRACK_MAX_INTERVAL_TICKS
+    int track_interval;   //!< Ticks the goal takes to reach the latest setpoint, the interval before it
+    int track_position;   //!< Whole steps of the filtered setpoint, the target follows it
+    float track_fraction; //!< Fraction of a step of the filtered setpoint, 0 to 1
+    float track_velocity; //!< Speed of the filtered setpoint in steps/s, positive forward
+    uint32_t track_setpoints; //!< Setpoints received since tracking was engaged
+    stepper_trigger_t triggers[STEPPER_MAX_TRIGGERS]; //!< Position synchronised output triggers
+    int trigger_count;    //!< Number of trigger entries to check, zero skips the checks
+    int trigger_pulses;   //!< Trigger pulses in progress, the step engine runs until they end
+    float step_phase;     //!< Fraction of the next step travelled
+    bool step_pin_high;   //!< Step pulse in progress, ended on the next tick
+    bool validate_only;   //!< Scratch copy for checking a command batch or Modbus write, stepper_enable() leaves the pin alone
+    volatile uint32_t sequence; //!< Seqlock sequence count, odd while an update is in progress
 } stepper_state_t;
 
+/*!
+ * @brief Consistent copy of the stepper state for readers
+ */
+typedef struct stepper_snapshot
+{
+    int current_position; //!< Current position in steps
+    int target_position;  //!< Target position in steps
+    int step_period;      //!< Step period in TIMMER_INTERVAL_US units
+    bool moving;          //!< Is the stepper currently moving
+    bool enabled;         //!< Is the stepper enabled
+    float velocity;       //!< Current speed in steps/s
+    int direction;        //!< Direction of travel
+    int acceleration;     //!< Acceleration in steps/s^2
+    int deceleration;     //!< Deceleration in steps/s^2
+    int feed_override;    //!< Feed rate override in percent
+    int estop_mode;       //!< Estop mode
+    int estop_deceleration; //!< Estop deceleration in steps/s^2
+    bool estop_stopping;  //!< Category 1 estop stop in progress
+    int backlash_steps;   //!< Lead screw backlash in steps
+    int backlash_slack;   //!< Motor position within the backlash
+    int approach_mode;    //!< Unidirectional approach mode
+    int approach_steps;   //!< Unidirectional approach overshoot in steps
+    int approach_target;  //!< Final target while approach_pending
+    bool approach_pending; //!< Moving to the overshoot target
+    stepper_speed_zone_t speed_zones[STEPPER_MAX_SPEED_ZONES]; //!< Position dependent speed limits
+    stepper_accel_point_t accel_points[STEPPER_MAX_ACCEL_POINTS]; //!< Acceleration against speed
+    int accel_point_count; //!< Number of acceleration points in use
+    uint32_t plan_hits;   //!< Moves started from a cached plan
+    uint32_t plan_misses; //!< Moves that had to be planned
+    uint32_t plan_retargets; //!< Moves retargeted while moving
+    bool gear_enabled;    //!< Following the external axis
+    int gear_numerator;   //!< Gearing ratio numerator
+    int gear_denominator; //!< Gearing ratio denominator
+    bool track_enabled;   //!< Following a stream of setpoints
+    int track_setpoint;   //!< Latest setpoint in steps
+    uint32_t track_setpoints; //!< Setpoints received since tracking was engaged
+    stepper_trigger_t triggers[STEPPER_MAX_TRIGGERS]; //!< Position synchronised output triggers
+} stepper_snapshot_t;
+
 // Function prototypes
 
 /*!
@@ -63,9 +252,55 @@ typedef struct stepper_state
  */
 bool stepper_init(stepper_state_t* stepper, int initial_position, int step_period);
 
+/*!
+ * @brief Mark the start of an update to the stepper state
+ *
+ * @note: Only the writer context may call this, updates must not nest.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @return: none
+ */
+void stepper_write_begin(stepper_state_t* stepper);
+
+/*!
+ * @brief Mark the end of an update to the stepper state
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @return: none
+ */
+void stepper_write_end(stepper_state_t* stepper);
+
+/*!
+ * @brief Take a consistent snapshot of the stepper state
+ *
+ * @note: Safe to call from any context. A reader that pre-empts the writer mid-update
+ *        cannot succeed, so the read is retried at most STEPPER_SNAPSHOT_RETRIES times.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param snapshot: pointer to snapshot to fill in, must not be NULL
+ * @return: true if a consistent snapshot was taken, false otherwise
+ */
+bool stepper_get_snapshot(const stepper_state_t* stepper, stepper_snapshot_t* snapshot);
+
+/*!
+ * @brief Set the current position of the stepper motor
+ *
+ * @note: Refused while moving or braking for an estop, the stepper must be stopped first.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param position: new current position in steps must be between MIN_STEPPER_POSITION and MAX_STEPPER_POSITION
+ * @return: true on success, false if moving or the position is invalid
+ */
+bool stepper_set_current_position(stepper_state_t* stepper, int position);
+
 /*!
  * @brief Set the target position for the stepper motor
  *
+ * @note: May be called while moving. The step engine replans from the current position
+ *        and speed, it keeps going or speeds up if the new target is further on, brakes
+ *        early if it is nearer, and brakes to a stop and reverses only if it is behind or
+ *        too near to stop for.
+ *
  * @param stepper: pointer to stepper state structure, must not be NULL
  * @param target_position: target position in steps must be between MIN_STEPPER_POSITION and MAX_STEPPER_POSITION
  * @return: true on success, false on failure
@@ -81,6 +316,170 @@ bool stepper_set_target_position(stepper_state_t* stepper, int target_position);
  */
 bool stepper_set_step_period(stepper_state_t* stepper, int step_period_us);
 
+/*!
+ * @brief Set the acceleration for the stepper motor
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param acceleration: acceleration in steps/s^2 between STEPPER_MIN_ACCELERATION and STEPPER_MAX_ACCELERATION
+ * @return: true on success, false on failure
+ */
+bool stepper_set_acceleration(stepper_state_t* stepper, int acceleration);
+
+/*!
+ * @brief Set the deceleration for the stepper motor
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param deceleration: deceleration in steps/s^2 between STEPPER_MIN_ACCELERATION and STEPPER_MAX_ACCELERATION
+ * @return: true on success, false on failure
+ */
+bool stepper_set_deceleration(stepper_state_t* stepper, int deceleration);
+
+/*!
+ * @brief Set how the stepper responds to the estop input
+ *
+ * @note: In STEPPER_ESTOP_MODE_DECEL a moving stepper keeps holding torque while it brakes
+ *        at the estop deceleration, and is de-energised once stopped or after
+ *        STEPPER_ESTOP_STOP_TIMEOUT_MS, so the position stays valid.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param mode: STEPPER_ESTOP_MODE_INSTANT or STEPPER_ESTOP_MODE_DECEL
+ * @param deceleration: estop deceleration in steps/s^2 between STEPPER_MIN_ACCELERATION and STEPPER_MAX_ACCELERATION
+ * @return: true on success, false on failure
+ */
+bool stepper_set_estop_mode(stepper_state_t* stepper, int mode, int deceleration);
+
+/*!
+ * @brief Set the backlash compensation
+ *
+ * @note: Each reversal inserts the steps needed to cross the backlash before the position
+ *        changes, these steps are not counted in current_position. The backlash is assumed
+ *        taken up on the side of the last direction of travel.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param steps: backlash in steps between 0 and STEPPER_MAX_BACKLASH_STEPS
+ * @return: true on success, false on failure
+ */
+bool stepper_set_backlash(stepper_state_t* stepper, int steps);
+
+/*!
+ * @brief Set the unidirectional approach mode
+ *
+ * @note: With a direction set, a target that would be reached travelling the other way is
+ *        first overshot by the given steps, so every move finishes travelling the same way.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param mode: STEPPER_APPROACH_OFF, STEPPER_APPROACH_FORWARD or STEPPER_APPROACH_BACKWARD
+ * @param steps: overshoot in steps between 1 and STEPPER_STEPS_PER_REV
+ * @return: true on success, false on failure
+ */
+bool stepper_set_approach(stepper_state_t* stepper, int mode, int steps);
+
+/*!
+ * @brief Set or clear a position dependent speed limit zone
+ *
+ * @note: The step engine brakes before entering a zone so the speed is already within the
+ *        limit at the first step inside it. Zones may overlap, the lowest limit applies.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param index: zone index between 0 and STEPPER_MAX_SPEED_ZONES - 1
+ * @param start: first position in the zone, within the travel limits
+ * @param end: last position in the zone, not below start and within the travel limits
+ * @param max_speed: speed limit in steps/s up to STEPPER_MAX_SPEED, 0 to clear the zone
+ * @return: true on success, false on failure
+ */
+bool stepper_set_speed_zone(stepper_state_t* stepper, int index, int start, int end, int max_speed);
+
+/*!
+ * @brief Set or clear a point on the speed dependent acceleration table
+ *
+ * @note: While the table has points it replaces the fixed acceleration and deceleration,
+ *        the acceleration is interpolated between points and braking in each segment uses
+ *        the lower of its two points. Points are kept in increasing speed order, a new point
+ *        goes at the end of the table and clearing a point clears all points above it.
+ *        Category 1 estop braking still uses the estop deceleration.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param index: point index, at most the number of points in use
+ * @param speed: speed in steps/s up to STEPPER_MAX_SPEED, between its neighbours
+ * @param acceleration: acceleration at this speed in steps/s^2, 0 to clear from this point up
+ * @return: true on success, false on failure
+ */
+bool stepper_set_accel_point(stepper_state_t* stepper, int index, int speed, int acceleration);
+
+/*!
+ * @brief Engage or disengage electronic gearing to an external axis
+ *
+ * @note: While engaged the target follows the external count at numerator / denominator
+ *        stepper steps per external step, from the current position and count. The step
+ *        engine ramps, so the stepper lags a fast external axis by its braking distance.
+ *        A new target, a stop, an estop or setting the position disengages the gearing,
+ *        as does engaging setpoint tracking.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param enable: true to engage, false to disengage
+ * @param numerator: stepper steps, non zero, at most STEPPER_MAX_GEAR_RATIO either way
+ * @param denominator: external steps between 1 and STEPPER_MAX_GEAR_RATIO
+ * @param count: current external count
+ * @return: true on success, false on failure
+ */
+bool stepper_set_gearing(stepper_state_t* stepper, bool enable, int numerator, int denominator, int32_t count);
+
+/*!
+ * @brief Engage or disengage setpoint tracking
+ *
+ * @note: While engaged the target follows a filtered copy of the latest setpoint, limited
+ *        to the cruise speed, acceleration and deceleration, so a stream of setpoints is
+ *        followed smoothly instead of each one starting a new move. Disengaging finishes
+ *        at the latest setpoint. A new target, a stop, an estop, setting the position or
+ *        engaging gearing also disengages the tracking.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param enable: true to engage from the current position, false to disengage
+ * @return: true on success, false on failure
+ */
+bool stepper_set_tracking(stepper_state_t* stepper, bool enable);
+
+/*!
+ * @brief Give setpoint tracking a new setpoint
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param setpoint: setpoint in steps between MIN_STEPPER_POSITION and MAX_STEPPER_POSITION
+ * @return: true on success, false if tracking is not engaged or the setpoint is invalid
+ */
+bool stepper_track_setpoint(stepper_state_t* stepper, int setpoint);
+
+/*!
+ * @brief Set or clear a position synchronised output trigger
+ *
+ * @note: The step engine drives the pin to STEPPER_TRIGGER_ACTIVE_LEVEL on the tick the
+ *        step onto the position is issued, and back after the pulse length, every time the
+ *        position is reached travelling in the given direction. Backlash steps never fire.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param index: trigger index between 0 and STEPPER_MAX_TRIGGERS - 1
+ * @param position: position that fires the trigger, within the travel limits
+ * @param pin: GPIO output pin up to STEPPER_MAX_TRIGGER_PIN, not a stepper or board pin,
+ *             the caller keeps the pins of other peripherals out,
+ *             STEPPER_TRIGGER_UNUSED to clear the trigger
+ * @param pulse_us: pulse length between TIMER_INTERVAL_US and STEPPER_MAX_TRIGGER_PULSE_US
+ * @param direction: STEPPER_DIRECTION_FORWARD, STEPPER_DIRECTION_BACKWARD or STEPPER_TRIGGER_BOTH
+ * @return: true on success, false on failure
+ */
+bool stepper_set_trigger(stepper_state_t* stepper, int index, int position, int pin, int pulse_us, int direction);
+
+/*!
+ * @brief Set the feed rate override for the stepper motor
+ *
+ * @note: Scales the speed set by the step period, a move in progress ramps to the
+ *        new speed at the configured acceleration. The speed is never above that of
+ *        MIN_STEPPER_PERIOD.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @param percent: override between STEPPER_MIN_FEED_OVERRIDE and STEPPER_MAX_FEED_OVERRIDE
+ * @return: true on success, false on failure
+ */
+bool stepper_set_feed_override(stepper_state_t* stepper, int percent);
+
 /*!
  * @brief Stop the stepper motor, setting target position to current position
  *
@@ -89,23 +488,77 @@ bool stepper_set_step_period(stepper_state_t* stepper, int step_period_us);
  */
 bool stepper_stop(stepper_state_t* stepper);
 
+/*!
+ * @brief Stop the stepper motor at the configured deceleration
+ *
+ * @note: The target is moved to the nearest position the stepper can stop at, counting
+ *        any backlash still to cross, even when the old target is nearer. The step engine
+ *        then ramps down and the stepper stops with a valid position, moving is false once
+ *        stopped.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @return: true on success, false on failure
+ */
+bool stepper_stop_decelerate(stepper_state_t* stepper);
+
 /*!
  * @brief Enable the stepper motor
  *
+ * @note: Disabling also turns off gearing and tracking.
+ *
  * @param stepper: pointer to stepper state structure, must not be NULL
  * @param enable: true to enable, false to disable
  * @return: true on success, false on failure
  */
 bool stepper_enable(stepper_state_t* stepper, bool enable);
 
+/*!
+ * @brief Copy the stepper state to the scratch state, for checking changes before applying them
+ *
+ * @note: There is one scratch state, shared by the command batches and the Modbus writes.
+ *        Both run from the millisecond tasks, so never at once. It is flagged validate_only,
+ *        so stepper_enable() on it leaves the enable pin alone.
+ *
+ * @param stepper: pointer to stepper state structure, must not be NULL
+ * @return: pointer to the scratch state, valid until the next call
+ */
+stepper_state_t* stepper_scratch_copy(const stepper_state_t* stepper);
+
 /*!
  * @brief Process stepper movement
  *
+ * @note: Called every TIMER_INTERVAL_US while moving, while the step pin is high and while
+ *        trigger pulses are in progress. The speed ramps towards the step
+ *        period speed scaled by the feed override, limited by the braking speed needed
+ *        to stop at the target. If the target is behind the direction of travel the
+ *        stepper decelerates to a stop and reverses.
+ *
  * @param stepper: pointer to stepper state structure
  * @return: true if stepper is still moving, false if it has reached target
  */
 bool process_stepper_movement(stepper_state_t* stepper);
 
+/*!
+ * @brief Process electronic gearing
+ *
+ * @note: Called every TIMER_INTERVAL_US while gearing is engaged, before the movement.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @param count: latest external count
+ * @return: true if gearing is engaged, false otherwise
+ */
+bool process_stepper_gearing(stepper_state_t* stepper, int32_t count);
+
+/*!
+ * @brief Process setpoint tracking
+ *
+ * @note: Called every TIMER_INTERVAL_US while tracking is engaged, before the movement.
+ *
+ * @param stepper: pointer to stepper state structure
+ * @return: true if tracking is engaged, false otherwise
+ */
+bool process_stepper_tracking(stepper_state_t* stepper);
+
 /*!
  * @brief Process stepper estop input
  * @param stepper: pointer to stepper state structure
@@ -13,6 +13,7 @@
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
 #include "sys_timer.h"
+#include "wcet.h"
 
 /*! 
  * @brief Global ten microsecond ticks count
@@ -38,6 +39,7 @@ volatile int ms_ticks_count = 0;
 bool timer_callback(struct repeating_timer *t)
 {
     static int us_count = 0;
+    WCET_START(wcet_start);
     // This function is called every 10 microseconds
     us_count++;
     if (us_count >= (1000 / TIMER_INTERVAL_US)) // 100 calls = 1 ms
@@ -46,5 +48,6 @@ bool timer_callback(struct repeating_timer *t)
         ms_ticks_count++;
     }
     ten_us_ticks_count++;
+    WCET_STOP(WCET_TIMER_CALLBACK, wcet_start);
     return true;    
 }
@@ -0,0 +1,63 @@
+/**
+    * @file task.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of the cooperative task registry
+    *
+    * This file contains the task table and the functions to register, find and run tasks.
+*/
+
+#include <string.h>
+#include "task.h"
+
+static task_t task_table[TASK_MAX];
+static int task_count = 0;
+
+/* -------------------------- task functions -----------------------------*/
+bool task_register(const char* name, task_rate_t rate, task_function_t run, void* context)
+{
+    if( name == NULL || run == NULL || task_count >= TASK_MAX ||
+        (rate != TASK_RATE_MS && rate != TASK_RATE_TEN_US) )
+    {
+        return false;
+    }
+
+    task_table[task_count].name = name;
+    task_table[task_count].rate = rate;
+    task_table[task_count].run = run;
+    task_table[task_count].context = context;
+    task_count++;
+    return true;
+}
+
+task_t* task_find(const char* name)
+{
+    if( name == NULL )
+    {
+        return NULL;
+    }
+
+    for(int i = 0; i < task_count; i++)
+    {
+        if( strcmp(task_table[i].name, name) == 0 )
+        {
+            return &task_table[i];
+        }
+    }
+    return NULL;
+}
+
+void task_run(task_rate_t rate)
+{
+    for(int i = 0; i < task_count; i++)
+    {
+        task_t* task = &task_table[i];
+
+        if( task->rate == rate )
+        {
+            task->run(task->context);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/**
+    * @file task.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions and functions for the cooperative task registry
+    *
+    * The superloop runs the registered tasks of each rate in registration order, every
+    * millisecond tick or every ten microsecond tick, so the order of task_register() calls
+    * is the order the tasks run in. Each task must return promptly.
+    *
+    * A task or command that has to wait, e.g. for a move to finish, is written as a
+    * protothread: a stackless coroutine that returns TASK_WAITING at each wait and carries
+    * on from the same place on its next call. The resume point is a source line number
+    * held in a task_pt_t, so:
+    *
+    *   - local variables are not kept across a wait, keep state in static storage
+    *   - only one TASK_WAIT_UNTIL() or TASK_YIELD() may be used per source line
+    *   - waits may not be placed inside a switch statement of the protothread itself
+    *
+    *   static task_status_t example(task_pt_t* pt)
+    *   {
+    *       TASK_BEGIN(pt);
+    *       TASK_WAIT_UNTIL(pt, condition());
+    *       ...
+    *       TASK_END(pt);
+    *   }
+*/
+
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TASK_MAX                            16      // Most tasks registered over both rates
+
+/*!
+ * @brief Rate a registered task runs at
+ */
+typedef enum task_rate
+{
+    TASK_RATE_MS = 0,       //!< Every millisecond tick
+    TASK_RATE_TEN_US,       //!< Every ten microsecond tick
+} task_rate_t;
+
+/*!
+ * @brief Result of running a protothread
+ */
+typedef enum task_status
+{
+    TASK_WAITING = 0,       //!< Waiting, call again on a later tick
+    TASK_DONE,              //!< Finished, the next call starts from the beginning
+} task_status_t;
+
+/*!
+ * @brief Resume point of a protothread, zero to start from the beginning
+ */
+typedef struct task_pt
+{
+    int line;               //!< Source line to resume at
+} task_pt_t;
+
+/*!
+ * @brief Task function, returns true if it had work to do on this tick
+ */
+typedef bool (*task_function_t)(void* context);
+
+/*!
+ * @brief Registered task
+ */
+typedef struct task
+{
+    const char* name;       //!< Name, for task_find()
+    task_rate_t rate;       //!< Rate the task runs at
+    task_function_t run;    //!< Function called each tick
+    void* context;          //!< Passed to the function
+} task_t;
+
+/* ---- Protothread macros ---- */
+#define TASK_INIT(pt)                       do { (pt)->line = 0; } while(0)
+#define TASK_BEGIN(pt)                      switch((pt)->line) { case 0:
+#define TASK_WAIT_UNTIL(pt, condition)      do { (pt)->line = __LINE__; __attribute__((fallthrough)); case __LINE__: \
+                                                 if(!(condition)) { return TASK_WAITING; } } while(0)
+#define TASK_YIELD(pt)                      do { (pt)->line = __LINE__; return TASK_WAITING; case __LINE__:; } while(0)
+#define TASK_EXIT(pt)                       do { (pt)->line = 0; return TASK_DONE; } while(0)
+#define TASK_END(pt)                        } (pt)->line = 0; return TASK_DONE
+
+/*!
+ * @brief Add a task to the end of the list for its rate
+ *
+ * @param name: task name, a string literal
+ * @param rate: rate the task runs at
+ * @param run: function called each tick
+ * @param context: passed to the function
+ * @return: true on success, false if the registry is full or a parameter is invalid
+ */
+bool task_register(const char* name, task_rate_t rate, task_function_t run, void* context);
+
+/*!
+ * @brief Find a registered task by name
+ *
+ * @note: The simulator uses this to wrap a task with its own timing.
+ *
+ * @param name: task name
+ * @return: pointer to the task, or NULL if not registered
+ */
+task_t* task_find(const char* name);
+
+/*!
+ * @brief Run every task registered for a rate, in registration order
+ *
+ * @param rate: rate whose tick is due
+ * @return: none
+ */
+void task_run(task_rate_t rate);
+
+#endif // TASK_H
@@ -0,0 +1,146 @@
+/**
+    * @file wcet.c
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief implementation of worst case execution time measurement
+    * 
+    * This file contains the per function worst case cycle records and the report.
+*/
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "wcet.h"
+
+#if CLAW_WCET_ENABLE
+#include "hardware/clocks.h"
+
+/*!
+ * @brief Measurement record for one function
+ */
+typedef struct wcet_record
+{
+    uint32_t count;       //!< Number of measurements taken
+    uint32_t max_cycles;  //!< Worst case cycles seen
+} wcet_record_t;
+
+static volatile wcet_record_t wcet_records[WCET_COUNT];
+
+/*!
+ * @brief Names of measured functions, indexed by wcet_id_t
+ */
+static const char* const wcet_names[WCET_COUNT] =
+{
+    "timer_callback",
+    "process_stepper_movement",
+    "process_stepper_estop",
+    "process_pending_command",
+    "process_stepper_gearing",
+    "process_stepper_tracking",
+    "process_capture",
+    "process_move_stats",
+    "process_modbus",
+    "claw_set",
+    "led_period",
+    "set_stepper_period",
+    "set_stepper_zero",
+    "move_stepper_absolute",
+    "move_stepper_relative",
+    "move_stepper_rotations",
+    "move_stepper_bump_down",
+    "stop_stepper",
+    "get_stepper_status",
+    "enable_stepper",
+    "disable_stepper",
+    "echo",
+    "wait_idle",
+    "set_stepper_accel",
+    "feed_override",
+    "set_stepper_decel",
+    "estop_mode",
+    "set_backlash",
+    "approach_mode",
+    "speed_zone",
+    "accel_point",
+    "gear",
+    "trigger",
+    "probe",
+    "arm_move",
+    "track",
+    "@setpoint",
+    "move_stats",
+    "batch",
+    "modbus",
+};
+
+void wcet_init(void)
+{
+    // Enable trace so the DWT is clocked, then start the cycle counter
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+    wcet_reset();
+}
+
+void wcet_record(wcet_id_t id, uint32_t cycles)
+{
+    // Each function is only measured from one context, so no locking is needed
+    if(id >= WCET_COUNT)
+    {
+        return;
+    }
+
+    wcet_records[id].count++;
+    if(cycles > wcet_records[id].max_cycles)
+    {
+        wcet_records[id].max_cycles = cycles;
+    }
+}
+
+void wcet_reset(void)
+{
+    for(int i = 0; i < WCET_COUNT; i++)
+    {
+        wcet_records[i].count = 0;
+        wcet_records[i].max_cycles = 0;
+    }
+}
+
+bool wcet_report(void)
+{
+    uint32_t cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+
+    printf("WCET Report (%lu MHz):\n", (unsigned long)cycles_per_us);
+    printf("  %-26s %10s %10s %8s\n", "Function", "Count", "Cycles", "us");
+    for(int i = 0; i < WCET_COUNT; i++)
+    {
+        uint32_t max_cycles = wcet_records[i].max_cycles;
+        printf("  %-26s %10lu %10lu %8.2f\n", wcet_names[i], (unsigned long)wcet_records[i].count,
+               (unsigned long)max_cycles, (double)max_cycles / cycles_per_us);
+    }
+    return true;
+}
+
+#else
+
+void wcet_init(void)
+{
+}
+
+void wcet_record(wcet_id_t id, uint32_t cycles)
+{
+    (void)id;
+    (void)cycles;
+}
+
+void wcet_reset(void)
+{
+}
+
+bool wcet_report(void)
+{
+    return false;
+}
+
+#endif
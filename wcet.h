@@ -0,0 +1,137 @@
+/**
+    * @file wcet.h
+    * @author Jon Wade
+    * @date  17 Oct 2026
+    * @copyright (c) 2025 Jon Wade. Standard MIT License applies. See LICENSE file.
+    *
+    * @brief Definitions, functions and macros for worst case execution time measurement
+    * 
+    * When built with CLAW_WCET_ENABLE (cmake -DCLAW_WCET=ON) the timer callback, stepper
+    * processing and command handlers are timed with the DWT cycle counter and the worst
+    * case cycles for each are kept. Without it the measurement macros compile to nothing.
+*/
+
+#ifndef WCET_H
+#define WCET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef CLAW_WCET_ENABLE
+#define CLAW_WCET_ENABLE                    0
+#endif
+
+#if CLAW_WCET_ENABLE
+#include "hardware/structs/m33.h"
+#endif
+
+/*!
+ * @brief Identifiers for measured functions
+ *
+ * Keep in step with the names table in wcet.c
+ */
+typedef enum wcet_id
+{
+    WCET_TIMER_CALLBACK = 0,
+    WCET_STEPPER_MOVEMENT,
+    WCET_STEPPER_ESTOP,
+    WCET_COMMAND_PENDING,
+    WCET_STEPPER_GEARING,
+    WCET_STEPPER_TRACKING,
+    WCET_CAPTURE,
+    WCET_MOVE_STATS,
+    WCET_MODBUS,
+    WCET_COMMAND_CLAW_SET,
+    WCET_COMMAND_LED_PERIOD,
+    WCET_COMMAND_SET_STEPPER_PERIOD,
+    WCET_COMMAND_SET_STEPPER_ZERO,
+    WCET_COMMAND_MOVE_ABSOLUTE,
+    WCET_COMMAND_MOVE_RELATIVE,
+    WCET_COMMAND_MOVE_ROTATIONS,
+    WCET_COMMAND_MOVE_BUMP_DOWN,
+    WCET_COMMAND_STOP,
+    WCET_COMMAND_GET_STATUS,
+    WCET_COMMAND_ENABLE,
+    WCET_COMMAND_DISABLE,
+    WCET_COMMAND_ECHO,
+    WCET_COMMAND_WAIT_IDLE,
+    WCET_COMMAND_SET_STEPPER_ACCEL,
+    WCET_COMMAND_FEED_OVERRIDE,
+    WCET_COMMAND_SET_STEPPER_DECEL,
+    WCET_COMMAND_ESTOP_MODE,
+    WCET_COMMAND_SET_BACKLASH,
+    WCET_COMMAND_APPROACH_MODE,
+    WCET_COMMAND_SPEED_ZONE,
+    WCET_COMMAND_ACCEL_POINT,
+    WCET_COMMAND_GEAR,
+    WCET_COMMAND_TRIGGER,
+    WCET_COMMAND_PROBE,
+    WCET_COMMAND_ARM_MOVE,
+    WCET_COMMAND_TRACK,
+    WCET_COMMAND_TRACK_SETPOINT,
+    WCET_COMMAND_MOVE_STATS,
+    WCET_COMMAND_BATCH,
+    WCET_COMMAND_MODBUS,
+    WCET_COUNT
+} wcet_id_t;
+
+#if CLAW_WCET_ENABLE
+/*!
+ * @brief Read the DWT cycle counter
+ *
+ * @param: none
+ * @return: current cycle count
+ */
+static inline uint32_t wcet_cycles(void)
+{
+    return m33_hw->dwt_cyccnt;
+}
+
+#define WCET_START(var)             uint32_t var = wcet_cycles()
+#define WCET_STOP(id, var)          wcet_record((id), wcet_cycles() - (var))
+#define WCET_MEASURE(id, expr)      ({ uint32_t wcet_start_ = wcet_cycles(); \
+                                       __typeof__(expr) wcet_result_ = (expr); \
+                                       wcet_record((id), wcet_cycles() - wcet_start_); \
+                                       wcet_result_; })
+#else
+#define WCET_START(var)
+#define WCET_STOP(id, var)
+#define WCET_MEASURE(id, expr)      (expr)
+#endif
+
+/*!
+ * @brief Initialise worst case execution time measurement
+ *
+ * @note: Enables the DWT cycle counter when measurement is built in, otherwise does nothing.
+ *
+ * @param: none
+ * @return: none
+ */
+void wcet_init(void);
+
+/*!
+ * @brief Record an execution time measurement
+ *
+ * @param id: measured function identifier
+ * @param cycles: measured execution time in cycles
+ * @return: none
+ */
+void wcet_record(wcet_id_t id, uint32_t cycles);
+
+/*!
+ * @brief Clear all recorded measurements
+ *
+ * @param: none
+ * @return: none
+ */
+void wcet_reset(void);
+
+/*!
+ * @brief Print the worst case execution time of each measured function
+ *
+ * @param: none
+ * @return: true on success, false if measurement is not built in
+ */
+bool wcet_report(void);
+
+#endif // WCET_H